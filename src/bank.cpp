@@ -0,0 +1,401 @@
+/*
+    This file is part of Roboverb
+
+    Copyright (C) 2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "bank.hpp"
+
+/** One vector's worth of instances.
+
+    Sample k of lane l of a delay line lives at data[k * lanes + l], and all
+    lanes of a line share one read/write index.  The lane count and the
+    arithmetic come from the BankKernels of the kernel set the group was
+    made with, so the group is as wide as the vectors that set runs.
+
+    Disabling a filter for a lane masks its writes, so the lane's delay line
+    and damping state stay as they were while the shared index moves on.
+    Roboverb resumes a re-enabled filter where it stopped, so when a lane is
+    re-enabled its column is rotated by however far the index moved in the
+    meantime.
+*/
+class RoboverbBank::Group {
+public:
+    enum { maxLanes = roboverb::kernels::maxBankLanes };
+
+    /** Floats in each scratch block, 4 kB whatever the lane count. */
+    enum { blockFloats = 1024 };
+
+    explicit Group (const roboverb::kernels::BankKernels& bankKernels)
+        : kernels (bankKernels),
+          lanes (bankKernels.lanes),
+          maxBlockSize (blockFloats / bankKernels.lanes) {
+        std::memset (input, 0, sizeof (input));
+        std::memset (inputL, 0, sizeof (inputL));
+        std::memset (inputR, 0, sizeof (inputR));
+
+        for (int l = 0; l < lanes; ++l) {
+            for (int i = 0; i < numCombs; ++i)
+                enabledCombs[l][i] = false;
+            for (int i = 0; i < numAllPasses; ++i)
+                enabledAllPasses[l][i] = false;
+            enabledCombs[l][3] = enabledCombs[l][4] = enabledCombs[l][5] = true;
+            enabledAllPasses[l][0] = enabledAllPasses[l][1] = true;
+        }
+
+        for (int i = 0; i < numCombs; ++i)
+            updateMask (combMask[i], combState[i], enabledCombs, i);
+        for (int i = 0; i < numAllPasses; ++i)
+            updateMask (allPassMask[i], allPassState[i], enabledAllPasses, i);
+
+        arena.reserve (arenaSize ((int) Roboverb::maxSampleRate));
+        for (int l = 0; l < lanes; ++l)
+            setParameters (l, Parameters());
+        setSampleRate (44100.0);
+    }
+
+    void setSampleRate (const double sampleRate) {
+        const int intSampleRate = (int) sampleRate;
+        arena.reserve (arenaSize (intSampleRate));
+
+        float* data = arena.get();
+        for (int i = 0; i < numCombs; ++i) {
+            for (int c = 0; c < numChannels; ++c) {
+                data = combLines[i][c].carve (data, Roboverb::combLength (c, i, intSampleRate), lanes);
+                for (int l = 0; l < lanes; ++l)
+                    frozenCombIndex[i][c][l] = 0;
+            }
+        }
+
+        for (int i = 0; i < numAllPasses; ++i) {
+            for (int c = 0; c < numChannels; ++c) {
+                data = allPassLines[i][c].carve (data, Roboverb::allPassLength (c, i, intSampleRate), lanes);
+                for (int l = 0; l < lanes; ++l)
+                    frozenAllPassIndex[i][c][l] = 0;
+            }
+        }
+
+        used = (size_t) (data - arena.get());
+        reset();
+
+        const double smoothTime = 0.01;
+        for (int l = 0; l < lanes; ++l) {
+            damping[l].reset (sampleRate, smoothTime);
+            feedback[l].reset (sampleRate, smoothTime);
+            dryGain[l].reset (sampleRate, smoothTime);
+            wetGain1[l].reset (sampleRate, smoothTime);
+            wetGain2[l].reset (sampleRate, smoothTime);
+        }
+    }
+
+    void reset() noexcept {
+        std::memset (arena.get(), 0, sizeof (float) * used);
+        std::memset (combLast, 0, sizeof (combLast));
+    }
+
+    void setParameters (const int lane, const Parameters& newParams) {
+        const Roboverb::Targets targets (newParams);
+        dryGain[lane].setValue (targets.dry);
+        wetGain1[lane].setValue (targets.wet1);
+        wetGain2[lane].setValue (targets.wet2);
+        damping[lane].setValue (targets.damping);
+        feedback[lane].setValue (targets.feedback);
+
+        gain[lane]       = targets.gain;
+        parameters[lane] = newParams;
+    }
+
+    const Parameters& getParameters (const int lane) const noexcept { return parameters[lane]; }
+
+    void setCombToggle (const int lane, const int index, const bool toggled) {
+        if (enabledCombs[lane][index] == toggled)
+            return;
+
+        for (int c = 0; c < numChannels; ++c)
+            toggleLane (combLines[index][c], frozenCombIndex[index][c][lane], lane, toggled);
+
+        enabledCombs[lane][index] = toggled;
+        updateMask (combMask[index], combState[index], enabledCombs, index);
+    }
+
+    void setAllPassToggle (const int lane, const int index, const bool toggled) {
+        if (enabledAllPasses[lane][index] == toggled)
+            return;
+
+        for (int c = 0; c < numChannels; ++c)
+            toggleLane (allPassLines[index][c], frozenAllPassIndex[index][c][lane], lane, toggled);
+
+        enabledAllPasses[lane][index] = toggled;
+        updateMask (allPassMask[index], allPassState[index], enabledAllPasses, index);
+    }
+
+    /** Processes the first numLanes lanes from the given channel pointers.
+        The remaining lanes run on silence and their output is dropped. */
+    void process (const float* const* left, const float* const* right,
+                  float* const* out1, float* const* out2,
+                  const int numLanes, const int numSamples) noexcept {
+        for (int pos = 0; pos < numSamples; pos += maxBlockSize)
+            render (left, right, out1, out2, numLanes, pos, std::min (numSamples - pos, maxBlockSize));
+    }
+
+private:
+    enum { numCombs     = Roboverb::numCombs,
+           numAllPasses = Roboverb::numAllPasses,
+           numChannels  = Roboverb::numChannels };
+
+    using Arena               = Roboverb::Arena;
+    using LinearSmoothedValue = Roboverb::LinearSmoothedValue;
+
+    /** Whether a filter is on in none, some or all lanes. */
+    enum LaneState { noLanes,
+                     someLanes,
+                     allLanes };
+
+    /** An interleaved delay line of `size` frames of `lanes` floats. */
+    struct Line {
+        float* data = nullptr;
+        int size = 0, index = 0, lanes = 1;
+
+        float* carve (float* const arenaData, const int newSize, const int numLanes) noexcept {
+            data  = arenaData;
+            size  = newSize;
+            index = 0;
+            lanes = numLanes;
+            return arenaData + Arena::padded (newSize * numLanes);
+        }
+
+        /** Reverses frames [from, to) of one lane in place. */
+        void reverse (const int lane, int from, int to) noexcept {
+            for (--to; from < to; ++from, --to)
+                std::swap (data[from * lanes + lane], data[to * lanes + lane]);
+        }
+
+        /** Moves every frame of one lane `by` frames later, wrapping. */
+        void rotate (const int lane, const int by) noexcept {
+            if (by == 0)
+                return;
+            reverse (lane, 0, size - by);
+            reverse (lane, size - by, size);
+            reverse (lane, 0, size);
+        }
+    };
+
+    size_t arenaSize (const int sampleRate) const noexcept {
+        size_t total = 0;
+        for (int c = 0; c < numChannels; ++c) {
+            for (int i = 0; i < numCombs; ++i)
+                total += Arena::padded (Roboverb::combLength (c, i, sampleRate) * lanes);
+            for (int i = 0; i < numAllPasses; ++i)
+                total += Arena::padded (Roboverb::allPassLength (c, i, sampleRate) * lanes);
+        }
+        return total;
+    }
+
+    /** A disabled lane remembers where its index stood.  Re-enabling it
+        lines the frame it would have read next up with the shared index. */
+    static void toggleLane (Line& line, int& frozenIndex, const int lane, const bool toggled) noexcept {
+        if (! toggled) {
+            frozenIndex = line.index;
+            return;
+        }
+
+        line.rotate (lane, (line.index - frozenIndex + line.size) % line.size);
+    }
+
+    template <int NumFilters>
+    void updateMask (float* const mask, LaneState& state,
+                     const bool (&enabled)[maxLanes][NumFilters], const int index) const noexcept {
+        int numOn = 0;
+        for (int l = 0; l < lanes; ++l) {
+            mask[l] = enabled[l][index] ? roboverb::simd::laneOn() : roboverb::simd::laneOff();
+            numOn += enabled[l][index] ? 1 : 0;
+        }
+
+        state = numOn == 0 ? noLanes : (numOn == lanes ? allLanes : someLanes);
+    }
+
+    bool anySmoothing (const LinearSmoothedValue* const values) const noexcept {
+        for (int l = 0; l < lanes; ++l)
+            if (values[l].isSmoothing())
+                return true;
+        return false;
+    }
+
+    void render (const float* const* left, const float* const* right,
+                 float* const* out1, float* const* out2,
+                 const int numLanes, const int pos, const int numSamples) noexcept {
+        // lanes past numLanes keep the zeros written when the group was made
+        for (int l = 0; l < numLanes; ++l) {
+            const float* const srcL = left[l] + pos;
+            const float* const srcR = right[l] + pos;
+            for (int i = 0; i < numSamples; ++i) {
+                inputL[i * lanes + l] = srcL[i];
+                inputR[i * lanes + l] = srcR[i];
+                input[i * lanes + l]  = (srcL[i] + srcR[i]) * gain[l];
+            }
+        }
+
+        std::fill_n (wet[0], numSamples * lanes, 0.0f);
+        std::fill_n (wet[1], numSamples * lanes, 0.0f);
+
+        const bool rampCombs = anySmoothing (damping) || anySmoothing (feedback);
+        if (rampCombs) {
+            for (int l = 0; l < lanes; ++l) {
+                damping[l].render (dampBlock + l, numSamples, lanes);
+                feedback[l].render (feedBlock + l, numSamples, lanes);
+            }
+        } else {
+            for (int l = 0; l < lanes; ++l) {
+                dampBlock[l] = damping[l].getTargetValue();
+                feedBlock[l] = feedback[l].getTargetValue();
+            }
+        }
+
+        for (int i = 0; i < numCombs; ++i) {
+            if (combState[i] == noLanes)
+                continue;
+            const bool masked = combState[i] == someLanes;
+            const auto kernel = rampCombs ? (masked ? kernels.combRampedMasked : kernels.combRamped)
+                                          : (masked ? kernels.combMasked : kernels.comb);
+
+            float* const buffers[numChannels] = { combLines[i][0].data, combLines[i][1].data };
+            const int sizes[numChannels]      = { combLines[i][0].size, combLines[i][1].size };
+            int indices[numChannels]          = { combLines[i][0].index, combLines[i][1].index };
+            kernel (buffers, sizes, indices, combLast[i], combMask[i], input, dampBlock, feedBlock,
+                    wet[0], wet[1], numSamples);
+            combLines[i][0].index = indices[0];
+            combLines[i][1].index = indices[1];
+        }
+
+        for (int i = 0; i < numAllPasses; ++i) {
+            if (allPassState[i] == noLanes)
+                continue;
+            const auto kernel = allPassState[i] == someLanes ? kernels.allPassMasked : kernels.allPass;
+            for (int c = 0; c < numChannels; ++c) {
+                Line& line = allPassLines[i][c];
+                kernel (line.data, line.size, &line.index, allPassMask[i], wet[c], numSamples);
+            }
+        }
+
+        if (anySmoothing (dryGain) || anySmoothing (wetGain1) || anySmoothing (wetGain2)) {
+            for (int l = 0; l < lanes; ++l) {
+                dryGain[l].render (dryBlock + l, numSamples, lanes);
+                wetGain1[l].render (wetBlock[0] + l, numSamples, lanes);
+                wetGain2[l].render (wetBlock[1] + l, numSamples, lanes);
+            }
+            kernels.mixRamped (wet[0], wet[1], inputL, inputR, dryBlock, wetBlock[0], wetBlock[1], numSamples);
+        } else {
+            for (int l = 0; l < lanes; ++l) {
+                dryBlock[l]    = dryGain[l].getTargetValue();
+                wetBlock[0][l] = wetGain1[l].getTargetValue();
+                wetBlock[1][l] = wetGain2[l].getTargetValue();
+            }
+            kernels.mix (wet[0], wet[1], inputL, inputR, dryBlock, wetBlock[0], wetBlock[1], numSamples);
+        }
+
+        for (int l = 0; l < numLanes; ++l) {
+            float* const dstL = out1[l] + pos;
+            float* const dstR = out2[l] + pos;
+            for (int i = 0; i < numSamples; ++i) {
+                dstL[i] = wet[0][i * lanes + l];
+                dstR[i] = wet[1][i * lanes + l];
+            }
+        }
+    }
+
+    //==============================================================================
+    const roboverb::kernels::BankKernels& kernels;
+    const int lanes, maxBlockSize;
+
+    bool enabledCombs[maxLanes][numCombs];
+    bool enabledAllPasses[maxLanes][numAllPasses];
+    LaneState combState[numCombs], allPassState[numAllPasses];
+    alignas (roboverb::simd::alignment) float combMask[numCombs][maxLanes];
+    alignas (roboverb::simd::alignment) float allPassMask[numAllPasses][maxLanes];
+    int frozenCombIndex[numCombs][numChannels][maxLanes];
+    int frozenAllPassIndex[numAllPasses][numChannels][maxLanes];
+
+    Parameters parameters[maxLanes];
+    float gain[maxLanes];
+
+    Arena arena;
+    size_t used = 0;
+    Line combLines[numCombs][numChannels];
+    Line allPassLines[numAllPasses][numChannels];
+
+    /** The left then the right channel's comb state, `lanes` floats each. */
+    alignas (roboverb::simd::alignment) float combLast[numCombs][numChannels * maxLanes];
+
+    LinearSmoothedValue damping[maxLanes], feedback[maxLanes], dryGain[maxLanes], wetGain1[maxLanes], wetGain2[maxLanes];
+
+    alignas (roboverb::simd::alignment) float input[blockFloats];
+    alignas (roboverb::simd::alignment) float inputL[blockFloats];
+    alignas (roboverb::simd::alignment) float inputR[blockFloats];
+    alignas (roboverb::simd::alignment) float wet[numChannels][blockFloats];
+    alignas (roboverb::simd::alignment) float dampBlock[blockFloats];
+    alignas (roboverb::simd::alignment) float feedBlock[blockFloats];
+    alignas (roboverb::simd::alignment) float dryBlock[blockFloats];
+    alignas (roboverb::simd::alignment) float wetBlock[2][blockFloats];
+};
+
+//==============================================================================
+RoboverbBank::RoboverbBank (const int newNumInstances, const roboverb::kernels::Kernels& kernels)
+    : numInstances (std::max (0, newNumInstances)),
+      lanes (kernels.bank.lanes) {
+    for (int i = 0; i < numInstances; i += lanes)
+        groups.emplace_back (new Group (kernels.bank));
+}
+
+RoboverbBank::~RoboverbBank() = default;
+
+void RoboverbBank::setSampleRate (const double sampleRate) {
+    for (auto& group : groups)
+        group->setSampleRate (sampleRate);
+}
+
+void RoboverbBank::reset() {
+    for (auto& group : groups)
+        group->reset();
+}
+
+void RoboverbBank::setParameters (const int instance, const Parameters& newParams) {
+    groups[instance / lanes]->setParameters (instance % lanes, newParams);
+}
+
+const RoboverbBank::Parameters& RoboverbBank::getParameters (const int instance) const noexcept {
+    return groups[instance / lanes]->getParameters (instance % lanes);
+}
+
+void RoboverbBank::setCombToggle (const int instance, const int index, const bool toggled) {
+    groups[instance / lanes]->setCombToggle (instance % lanes, index, toggled);
+}
+
+void RoboverbBank::setAllPassToggle (const int instance, const int index, const bool toggled) {
+    groups[instance / lanes]->setAllPassToggle (instance % lanes, index, toggled);
+}
+
+void RoboverbBank::processStereo (const float* const* left, const float* const* right,
+                                  float* const* out1, float* const* out2,
+                                  const int numSamples) noexcept {
+    for (size_t g = 0; g < groups.size(); ++g) {
+        const int first = (int) g * lanes;
+        groups[g]->process (left + first, right + first, out1 + first, out2 + first,
+                            std::min (lanes, numInstances - first), numSamples);
+    }
+}
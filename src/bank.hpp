@@ -0,0 +1,83 @@
+/*
+    This file is part of Roboverb
+
+    Copyright (C) 2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "roboverb.hpp"
+
+/** Many independent reverbs processed together.
+
+    Instances are grouped by the vector width of the kernel set the bank is
+    made with, roboverb::kernels::select() unless told otherwise, and each
+    group stores its delay lines lane-interleaved, so one vector operation
+    advances the same filter of every instance in the group.  Every instance
+    has its own parameters, smoothing and comb/allpass toggles; a filter
+    only disabled for some lanes keeps those lanes' state untouched, exactly
+    like a disabled filter in Roboverb.
+
+    Each instance computes what a standalone Roboverb processing sample by
+    sample (setBlockProcessing (false)) computes with the same settings fed
+    the same audio, operation for operation; only the multiply-adds the
+    compiler may fuse in the wider kernel sets round differently.  Block
+    processing in Roboverb reorders the comb arithmetic to vectorise it
+    along time and agrees with the bank only to rounding.  The bank also
+    never sleeps: a Roboverb that has gone to sleep outputs zeros where the
+    bank outputs a tail already below Roboverb::silenceThreshold.
+    roboverb-bench --verify checks every lane against a standalone
+    Roboverb.
+*/
+class RoboverbBank {
+public:
+    using Parameters = Roboverb::Parameters;
+
+    explicit RoboverbBank (int numInstances,
+                           const roboverb::kernels::Kernels& kernels = roboverb::kernels::select());
+    ~RoboverbBank();
+
+    int getNumInstances() const noexcept { return numInstances; }
+
+    /** Returns how many instances run side by side in one group. */
+    int getNumLanes() const noexcept { return lanes; }
+
+    void setSampleRate (double sampleRate);
+
+    /** Clears the buffers of every instance. */
+    void reset();
+
+    void setParameters (int instance, const Parameters& newParams);
+    const Parameters& getParameters (int instance) const noexcept;
+
+    void setCombToggle (int instance, int index, bool toggled);
+    void setAllPassToggle (int instance, int index, bool toggled);
+
+    /** Processes one block for every instance.  Each array holds one
+        channel pointer per instance; all channels are numSamples long.
+        Outputs may be the same buffers as the inputs. */
+    void processStereo (const float* const* left, const float* const* right,
+                        float* const* out1, float* const* out2,
+                        int numSamples) noexcept;
+
+private:
+    class Group;
+    std::vector<std::unique_ptr<Group>> groups;
+    int numInstances, lanes;
+};
@@ -0,0 +1,1241 @@
+/*
+    This file is part of Roboverb
+
+    Copyright (C) 2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*  roboverb-bench: times the DSP core and prints the results as JSON.
+
+        roboverb-bench [--filter TEXT] [--output FILE] [--compare FILE] [--threshold PERCENT]
+        roboverb-bench --verify
+
+    --filter runs only the cases whose name contains TEXT.  --output writes
+    the JSON to FILE instead of stdout.  --compare reads a file written by an
+    earlier run, prints the change of every case found in both and exits
+    with 1 if any of them got slower by more than the threshold (default
+    10%).
+
+    --verify renders the same input with every kernel set this CPU can run
+    and exits with 1 if any of them strays from the scalar reference, or
+    renders differently when the outputs are the input buffers or when the
+    channels are rendered as separate tasks.  It also reports how far half
+    float delay lines take the output from float ones, as the level of the
+    difference below the output, and fails if that is less than
+    compactMinimumDb.  Then it reactivates reverbs the way the plugins do
+    and fails if anything but the first activation allocates, checks that
+    reset() renders what a full clear does, and that block processing
+    stays within blockTolerance of sample-major processing and double
+    precision I/O within kernelTolerance of float, stereo and mono, and
+    that every lane of a RoboverbBank stays within kernelTolerance of a
+    standalone reverb.  Last
+    it compares a reduced internal rate with the full rate at 96 and
+    192 kHz, see verifyReducedRate().
+    Set ROBOVERB_KERNEL to time a particular kernel set.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bank.hpp"
+#include "denormals.hpp"
+#include "roboverb.hpp"
+
+namespace {
+/** Every allocation the process has made, counted by the operators below. */
+std::atomic<long> numAllocations { 0 };
+} // namespace
+
+// Inlined into new and delete expressions, these would make GCC warn that
+// free() is handed memory from operator new.
+#if defined(__GNUC__)
+#    define ROBOVERB_NOINLINE __attribute__ ((noinline))
+#else
+#    define ROBOVERB_NOINLINE
+#endif
+
+ROBOVERB_NOINLINE void* operator new (std::size_t size) {
+    ++numAllocations;
+    if (void* const p = std::malloc (size > 0 ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+ROBOVERB_NOINLINE void* operator new (std::size_t size, std::align_val_t alignment) {
+    ++numAllocations;
+    const auto align = static_cast<std::size_t> (alignment);
+    size             = (size + align - 1) / align * align;
+#if defined(_MSC_VER)
+    if (void* const p = _aligned_malloc (size > 0 ? size : align, align))
+#else
+    if (void* const p = std::aligned_alloc (align, size > 0 ? size : align))
+#endif
+        return p;
+    throw std::bad_alloc();
+}
+
+// the array forms all end up in these
+ROBOVERB_NOINLINE void operator delete (void* p) noexcept { std::free (p); }
+
+#if defined(_MSC_VER)
+ROBOVERB_NOINLINE void operator delete (void* p, std::align_val_t) noexcept { _aligned_free (p); }
+#else
+ROBOVERB_NOINLINE void operator delete (void* p, std::align_val_t) noexcept { std::free (p); }
+#endif
+
+ROBOVERB_NOINLINE void operator delete (void* p, std::size_t) noexcept { operator delete (p); }
+
+ROBOVERB_NOINLINE void operator delete (void* p, std::size_t, std::align_val_t alignment) noexcept {
+    operator delete (p, alignment);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/** Seconds of audio rendered per measurement. */
+constexpr double benchSeconds = 4.0;
+
+/** Measurements taken per case, the fastest is reported. */
+constexpr int benchRuns = 5;
+
+/** Calls timed per measurement of setSampleRate() and reset(). */
+constexpr int callsPerRun = 50;
+
+/** Seconds of tail the denormal cases follow an impulse for, and the
+    length of each window they report. */
+constexpr int tailSeconds = 80, tailWindow = 10;
+
+struct Result {
+    std::string name;
+    const char* unit;
+    double value;
+};
+
+/** Runs `body` benchRuns times and returns the fastest run in nanoseconds
+    divided by `count`. */
+double fastest (const std::function<void()>& body, const double count) {
+    double best = 0.0;
+    for (int run = 0; run < benchRuns; ++run) {
+        const auto start = Clock::now();
+        body();
+        const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+        best = run == 0 ? elapsed.count() : std::min (best, elapsed.count());
+    }
+    return best / count;
+}
+
+/** The enable masks every processing case runs with. */
+struct Mask {
+    const char* name;
+    bool combs[8];
+    bool allPasses[4];
+};
+
+const Mask masks[] = {
+    { "default", { false, false, false, true, true, true, false, false }, { true, true, false, false } },
+    { "all", { true, true, true, true, true, true, true, true }, { true, true, true, true } },
+    { "none", { false, false, false, false, false, false, false, false }, { false, false, false, false } },
+};
+
+const double sampleRates[] = { 44100.0, 48000.0, 96000.0, 192000.0 };
+const int blockSizes[]     = { 16, 64, 256, 1024, 4096 };
+
+std::unique_ptr<Roboverb> makeReverb (const Mask& mask, const double sampleRate,
+                                      const Roboverb::Layout layout = Roboverb::Stereo) {
+    auto verb = std::make_unique<Roboverb> (layout);
+    for (int i = 0; i < 8; ++i)
+        verb->setCombToggle (i, mask.combs[i]);
+    for (int i = 0; i < 4; ++i)
+        verb->setAllPassToggle (i, mask.allPasses[i]);
+    verb->setSampleRate (sampleRate);
+    return verb;
+}
+
+std::vector<float> makeNoise (const size_t numSamples, const unsigned seed) {
+    std::vector<float> samples (numSamples);
+    std::mt19937 rng (seed);
+    std::uniform_real_distribution<float> noise (-1.0f, 1.0f);
+    for (auto& x : samples)
+        x = noise (rng);
+    return samples;
+}
+
+/** With automation on, every block alternates between two parameter sets
+    so the smoothers never settle. */
+void automate (Roboverb& verb, const long block) {
+    Roboverb::Parameters params;
+    params.roomSize = (block & 1) ? 0.9f : 0.3f;
+    params.damping  = (block & 1) ? 0.2f : 0.7f;
+    params.wetLevel = (block & 1) ? 0.5f : 0.25f;
+    params.width    = (block & 1) ? 1.0f : 0.5f;
+    verb.setParameters (params);
+}
+
+double measureStereo (Roboverb& verb, const int blockSize, const double sampleRate, const bool automation) {
+    const std::vector<float> left = makeNoise (blockSize, 1), right = makeNoise (blockSize, 2);
+    std::vector<float> out1 (blockSize), out2 (blockSize);
+
+    const auto numFrames = static_cast<long> (sampleRate * benchSeconds);
+    return fastest ([&]() {
+        long block = 0;
+        for (long pos = 0; pos < numFrames; pos += blockSize, ++block) {
+            if (automation)
+                automate (verb, block);
+            verb.processStereo (const_cast<float*> (left.data()), const_cast<float*> (right.data()),
+                                out1.data(), out2.data(), blockSize);
+        }
+    },
+                    (double) numFrames);
+}
+
+double measureMono (Roboverb& verb, const int blockSize, const double sampleRate, const bool automation) {
+    const std::vector<float> input = makeNoise (blockSize, 1);
+    std::vector<float> samples (blockSize);
+
+    const auto numFrames = static_cast<long> (sampleRate * benchSeconds);
+    return fastest ([&]() {
+        long block = 0;
+        for (long pos = 0; pos < numFrames; pos += blockSize, ++block) {
+            if (automation)
+                automate (verb, block);
+            // processMono works in place, so start every block from the noise
+            std::copy (input.begin(), input.end(), samples.begin());
+            verb.processMono (samples.data(), blockSize);
+        }
+    },
+                    (double) numFrames);
+}
+
+/** Renders with a modulation event on every frame, taken the way the
+    CLAP plugin takes them: the block's events are scanned for the latest
+    amount, which is folded into the parameters once before the block
+    renders.  The amounts follow a 2 Hz sine on the room size and wet
+    level. */
+double measureModulated (Roboverb& verb, const int blockSize, const double sampleRate) {
+    const std::vector<float> left = makeNoise (blockSize, 1), right = makeNoise (blockSize, 2);
+    std::vector<float> out1 (blockSize), out2 (blockSize);
+
+    std::vector<float> lfo ((size_t) (sampleRate / 2));
+    for (size_t i = 0; i < lfo.size(); ++i)
+        lfo[i] = 0.25f * (float) std::sin (2.0 * 3.14159265358979323846 * (double) i / (double) lfo.size());
+
+    const Roboverb::Parameters base;
+    const auto numFrames = static_cast<long> (sampleRate * benchSeconds);
+    return fastest ([&]() {
+        float offset = 0;
+        for (long pos = 0; pos < numFrames; pos += blockSize) {
+            bool changed = false;
+            for (int i = 0; i < blockSize; ++i) {
+                const float amount = lfo[(size_t) (pos + i) % lfo.size()];
+                changed |= amount != offset;
+                offset = amount;
+            }
+
+            if (changed) {
+                Roboverb::Parameters params;
+                params.roomSize = std::min (1.0f, std::max (0.0f, base.roomSize + offset));
+                params.wetLevel = std::min (1.0f, std::max (0.0f, base.wetLevel + offset));
+                verb.setParameters (params);
+            }
+
+            verb.processStereo (const_cast<float*> (left.data()), const_cast<float*> (right.data()),
+                                out1.data(), out2.data(), blockSize);
+        }
+    },
+                    (double) numFrames);
+}
+
+/** Renders an impulse followed by tailSeconds of silence through the
+    largest room and returns the ns/sample of each tailWindow seconds.  The
+    tail decays through the denormal range long before it counts as
+    silent, so without flushing to zero the later windows slow down many
+    times over. */
+std::vector<double> measureTail (const bool noDenormals, const double sampleRate) {
+    constexpr int blockSize = 256;
+    auto verb               = makeReverb (masks[1], sampleRate);
+    Roboverb::Parameters params;
+    params.roomSize = 1.0f;
+    verb->setParameters (params);
+
+    std::vector<float> left (blockSize), right (blockSize), out1 (blockSize), out2 (blockSize);
+    const auto windowFrames = static_cast<long> (sampleRate * tailWindow);
+    std::vector<double> windows;
+
+    left[0] = right[0] = 1.0f;
+    for (int w = 0; w < tailSeconds / tailWindow; ++w) {
+        const auto start = Clock::now();
+        for (long pos = 0; pos < windowFrames; pos += blockSize) {
+            // the guard goes on and off every block, as it does in the plugins
+            if (noDenormals) {
+                const roboverb::ScopedNoDenormals guard;
+                verb->processStereo (left.data(), right.data(), out1.data(), out2.data(), blockSize);
+            } else {
+                verb->processStereo (left.data(), right.data(), out1.data(), out2.data(), blockSize);
+            }
+            left[0] = right[0] = 0.0f;
+        }
+        const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+        windows.push_back (elapsed.count() / (double) windowFrames);
+    }
+
+    return windows;
+}
+
+/** Times `numInstances` reverbs either as one bank or as separate
+    Roboverbs, with float or half float delay lines, reporting nanoseconds
+    per sample per instance. */
+double measureMany (const int numInstances, const bool useBank, const bool compact,
+                    const int blockSize, const double sampleRate) {
+    const std::vector<float> input = makeNoise (2 * (size_t) numInstances * blockSize, 1);
+    std::vector<float> output (input.size());
+
+    std::vector<const float*> left (numInstances), right (numInstances);
+    std::vector<float*> out1 (numInstances), out2 (numInstances);
+    for (int i = 0; i < numInstances; ++i) {
+        left[i]  = input.data() + (size_t) (2 * i) * blockSize;
+        right[i] = left[i] + blockSize;
+        out1[i]  = output.data() + (size_t) (2 * i) * blockSize;
+        out2[i]  = out1[i] + blockSize;
+    }
+
+    RoboverbBank bank (useBank ? numInstances : 0);
+    std::vector<std::unique_ptr<Roboverb>> verbs;
+    for (int i = 0; ! useBank && i < numInstances; ++i) {
+        verbs.emplace_back (new Roboverb());
+        verbs.back()->setCompactStorage (compact);
+    }
+
+    bank.setSampleRate (sampleRate);
+    for (auto& verb : verbs)
+        verb->setSampleRate (sampleRate);
+
+    const auto numFrames = static_cast<long> (sampleRate * benchSeconds / numInstances);
+    return fastest ([&]() {
+        for (long pos = 0; pos < numFrames; pos += blockSize) {
+            if (useBank) {
+                bank.processStereo (left.data(), right.data(), out1.data(), out2.data(), blockSize);
+            } else {
+                for (int i = 0; i < numInstances; ++i)
+                    verbs[i]->processStereo (const_cast<float*> (left[i]), const_cast<float*> (right[i]),
+                                             out1[i], out2[i], blockSize);
+            }
+        }
+    },
+                    (double) numFrames * numInstances);
+}
+
+//==============================================================================
+std::vector<Result> runCases (const std::string& filter) {
+    std::vector<Result> results;
+    auto wanted = [&] (const std::string& name) { return name.find (filter) != std::string::npos; };
+
+    for (const char* channels : { "stereo", "mono" }) {
+        for (const auto& mask : masks) {
+            for (const double sampleRate : sampleRates) {
+                for (const int blockSize : blockSizes) {
+                    for (const bool automation : { false, true }) {
+                        const std::string name = std::string ("process/") + channels + "/" + mask.name + "/"
+                                                 + std::to_string ((int) sampleRate) + "/"
+                                                 + std::to_string (blockSize) + "/"
+                                                 + (automation ? "automated" : "static");
+                        if (! wanted (name))
+                            continue;
+
+                        const bool stereo = std::strcmp (channels, "stereo") == 0;
+                        auto verb         = makeReverb (mask, sampleRate, stereo ? Roboverb::Stereo : Roboverb::Mono);
+                        const double ns   = stereo ? measureStereo (*verb, blockSize, sampleRate, automation)
+                                                   : measureMono (*verb, blockSize, sampleRate, automation);
+                        results.push_back ({ name, "ns/sample", ns });
+                    }
+                }
+            }
+        }
+    }
+
+    // one or two combs and no allpasses, where there are too few combs to
+    // fill a vector across them
+    for (const int numCombs : { 1, 2 }) {
+        for (const bool automation : { false, true }) {
+            const std::string name = "combs/" + std::to_string (numCombs) + "/stereo/48000/256/"
+                                     + (automation ? "automated" : "static");
+            if (! wanted (name))
+                continue;
+            Mask mask = masks[2];
+            for (int i = 0; i < numCombs; ++i)
+                mask.combs[i] = true;
+            auto verb = makeReverb (mask, 48000.0);
+            results.push_back ({ name, "ns/sample", measureStereo (*verb, 256, 48000.0, automation) });
+        }
+    }
+
+    // CLAP modulation on every frame against none at all
+    for (const int blockSize : { 64, 256 }) {
+        for (const bool modulated : { false, true }) {
+            const std::string name = "modulation/stereo/all/48000/" + std::to_string (blockSize) + "/"
+                                     + (modulated ? "per-frame" : "static");
+            if (! wanted (name))
+                continue;
+            auto verb = makeReverb (masks[1], 48000.0);
+            results.push_back ({ name, "ns/sample", modulated ? measureModulated (*verb, blockSize, 48000.0)
+                                                              : measureStereo (*verb, blockSize, 48000.0, false) });
+        }
+    }
+
+    // the lines a 192 kHz host uses at full and reduced internal rate
+    for (const bool reduced : { false, true }) {
+        const std::string name = std::string ("memory/float/192000/") + (reduced ? "reduced" : "full");
+        if (! wanted (name))
+            continue;
+        Roboverb verb;
+        verb.setReducedInternalRate (reduced);
+        verb.setSampleRate (192000.0);
+        results.push_back ({ name, "bytes", (double) verb.getMemorySize() });
+    }
+
+    // the network at 48 kHz inside a 96 or 192 kHz host
+    for (const bool stereo : { true, false }) {
+        for (const double sampleRate : { 96000.0, 192000.0 }) {
+            const std::string name = std::string ("reduced/") + (stereo ? "stereo" : "mono") + "/all/"
+                                     + std::to_string ((int) sampleRate) + "/256/static";
+            if (! wanted (name))
+                continue;
+            auto verb = makeReverb (masks[1], sampleRate, stereo ? Roboverb::Stereo : Roboverb::Mono);
+            verb->setReducedInternalRate (true);
+            results.push_back ({ name, "ns/sample", stereo ? measureStereo (*verb, 256, sampleRate, false)
+                                                           : measureMono (*verb, 256, sampleRate, false) });
+        }
+    }
+
+    // sample-major processing, for comparison with the default block mode
+    for (const bool stereo : { true, false }) {
+        for (const int blockSize : { 64, 256, 1024 }) {
+            const std::string name = std::string ("samples/") + (stereo ? "stereo" : "mono") + "/default/44100/"
+                                     + std::to_string (blockSize) + "/static";
+            if (! wanted (name))
+                continue;
+            auto verb = makeReverb (masks[0], 44100.0, stereo ? Roboverb::Stereo : Roboverb::Mono);
+            verb->setBlockProcessing (false);
+            results.push_back ({ name, "ns/sample", stereo ? measureStereo (*verb, blockSize, 44100.0, false)
+                                                           : measureMono (*verb, blockSize, 44100.0, false) });
+        }
+    }
+
+    for (const bool useBank : { false, true }) {
+        const std::string name = std::string (useBank ? "bank" : "separate") + "/32/44100/256";
+        if (wanted (name))
+            results.push_back ({ name, "ns/sample", measureMany (32, useBank, false, 256, 44100.0) });
+    }
+
+    // half float delay lines: the memory an instance's lines use at 48 kHz
+    // and what it reserves, one instance whose lines stay in cache, and
+    // enough instances that their lines together stream from memory
+    for (const bool compact : { false, true }) {
+        const std::string storage = compact ? "half" : "float";
+        if (wanted ("memory/" + storage)) {
+            Roboverb verb;
+            verb.setCompactStorage (compact);
+            verb.setSampleRate (48000.0);
+            results.push_back ({ "memory/" + storage + "/48000", "bytes", (double) verb.getMemorySize() });
+            results.push_back ({ "memory/" + storage + "/reserved", "bytes", (double) verb.getReservedMemorySize() });
+        }
+
+        std::string name = "storage/" + storage + "/stereo/all/48000/256/static";
+        if (wanted (name)) {
+            auto verb = makeReverb (masks[1], 48000.0);
+            verb->setCompactStorage (compact);
+            results.push_back ({ name, "ns/sample", measureStereo (*verb, 256, 48000.0, false) });
+        }
+
+        name = "storage/" + storage + "/separate/64/48000/256";
+        if (wanted (name))
+            results.push_back ({ name, "ns/sample", measureMany (64, false, compact, 256, 48000.0) });
+    }
+
+    for (const double sampleRate : sampleRates) {
+        const std::string rate = std::to_string ((int) sampleRate);
+        auto verb              = makeReverb (masks[0], sampleRate);
+
+        if (wanted ("setSampleRate/" + rate)) {
+            const double ns = fastest ([&]() {
+                for (int i = 0; i < callsPerRun; ++i)
+                    verb->setSampleRate (sampleRate);
+            },
+                                       callsPerRun);
+            results.push_back ({ "setSampleRate/" + rate, "ns/call", ns });
+        }
+
+        if (wanted ("reset/" + rate)) {
+            const double ns = fastest ([&]() {
+                for (int i = 0; i < callsPerRun; ++i)
+                    verb->reset();
+            },
+                                       callsPerRun);
+            results.push_back ({ "reset/" + rate, "ns/call", ns });
+        }
+    }
+
+    // the tail after an impulse, with and without the guard the plugins use
+    for (const bool noDenormals : { false, true }) {
+        const std::string name = std::string ("tail/44100/") + (noDenormals ? "flushed" : "denormal");
+        if (! wanted (name))
+            continue;
+        const std::vector<double> windows = measureTail (noDenormals, 44100.0);
+        for (size_t w = 0; w < windows.size(); ++w)
+            results.push_back ({ name + "/" + std::to_string (w * tailWindow) + "s", "ns/sample", windows[w] });
+    }
+
+    return results;
+}
+
+//==============================================================================
+/** Largest difference allowed between a kernel and the reference.  Kernels
+    may fuse multiply-adds, which only moves the last bits. */
+constexpr float kernelTolerance = 1.0e-5f;
+
+/** Largest difference allowed between block and sample-major output.  The
+    comb kernels run the damping recursion along time, which rounds
+    differently from one sample at a time. */
+constexpr float blockTolerance = 1.0e-5f;
+
+/** How far below the float output the difference made by half float delay
+    lines has to stay, in dB. */
+constexpr double compactMinimumDb = 50.0;
+
+/** How far the wet level at a reduced internal rate may stray from the
+    full rate, and how far below the output their difference has to stay
+    under reducedCutoff Hz, in dB.  The delay lines round to whole network
+    samples, so the two drift apart by a sample or so per trip around a
+    comb and never cancel completely. */
+constexpr double reducedMaximumLevelDb = 0.5, reducedMinimumDb = 15.0;
+constexpr double reducedCutoff = 2000.0;
+
+struct Verification {
+    float reference = 0; /**< Largest difference from the reference kernels. */
+    float inPlace   = 0; /**< Largest difference when processing in place. */
+    float parallel  = 0; /**< Largest difference when rendering the channels as tasks. */
+    float compact   = 0; /**< Largest difference with half float delay lines. */
+    double compactDb = 0; /**< Level of the output over that difference, in dB. */
+};
+
+/** Every 7th block sets random parameters and every 11th turns a comb on
+    or off and an allpass the other way, the same for each of `verbs`. */
+void changeSettings (std::initializer_list<Roboverb*> verbs, std::mt19937& rng, const int block) {
+    std::uniform_real_distribution<float> unit (0.0f, 1.0f);
+    if (block % 7 == 0) {
+        Roboverb::Parameters params;
+        params.roomSize   = unit (rng);
+        params.damping    = unit (rng);
+        params.wetLevel   = unit (rng);
+        params.dryLevel   = unit (rng);
+        params.width      = unit (rng);
+        params.freezeMode = unit (rng) < 0.1f ? 1.0f : 0.0f;
+        for (auto* verb : verbs)
+            verb->setParameters (params);
+    }
+    if (block % 11 == 0) {
+        const int comb = (int) (rng() % 8), allPass = (int) (rng() % 4);
+        const bool on = (rng() & 1) != 0;
+        for (auto* verb : verbs) {
+            verb->setCombToggle (comb, on);
+            verb->setAllPassToggle (allPass, ! on);
+        }
+    }
+}
+
+/** Stands in for a host thread pool: runs the tasks last to first, so any
+    dependency between them shows up as a difference. */
+bool runTasksBackwards (void* context, const int numTasks) {
+    auto* verb = static_cast<Roboverb*> (context);
+    for (int task = numTasks; --task >= 0;)
+        verb->runTask (task);
+    return true;
+}
+
+/** Renders noise with automation, toggling and silence through a reverb on
+    `kernel` and one on the reference, and once more on `kernel` with the
+    output written over the input, with the channels run as tasks and with
+    half float delay lines. */
+Verification verifyKernel (const roboverb::kernels::Kernels& kernel, const double sampleRate, const unsigned seed) {
+    auto test = std::make_unique<Roboverb>(), ref = std::make_unique<Roboverb>(), inPlace = std::make_unique<Roboverb>();
+    auto parallel = std::make_unique<Roboverb>(), compact = std::make_unique<Roboverb>();
+    test->setKernels (kernel);
+    ref->setKernels (roboverb::kernels::reference());
+    inPlace->setKernels (kernel);
+    parallel->setKernels (kernel);
+    parallel->setTaskRunner (&runTasksBackwards, parallel.get(), 1);
+    compact->setKernels (kernel);
+    compact->setCompactStorage (true);
+
+    std::mt19937 rng (seed);
+    std::uniform_real_distribution<float> unit (0.0f, 1.0f);
+    const int maxBlock = 1500;
+    std::vector<float> left (maxBlock), right (maxBlock), out[10];
+    for (auto& o : out)
+        o.resize (maxBlock);
+
+    Verification worst;
+    double outputPower = 0, compactPower = 0;
+    for (auto* verb : { test.get(), ref.get(), inPlace.get(), parallel.get(), compact.get() })
+        verb->setSampleRate (sampleRate);
+
+    for (int block = 0; block < 400; ++block) {
+        const int len = 1 + (int) (rng() % maxBlock);
+        changeSettings ({ test.get(), ref.get(), inPlace.get(), parallel.get(), compact.get() }, rng, block);
+
+        const bool silent = block % 13 == 0;
+        for (int i = 0; i < len; ++i) {
+            left[i]  = silent ? 0.0f : unit (rng) - 0.5f;
+            right[i] = silent ? 0.0f : unit (rng) - 0.5f;
+        }
+
+        std::copy_n (left.data(), len, out[4].data());
+        std::copy_n (right.data(), len, out[5].data());
+
+        test->processStereo (left.data(), right.data(), out[0].data(), out[1].data(), len);
+        ref->processStereo (left.data(), right.data(), out[2].data(), out[3].data(), len);
+        inPlace->processStereo (out[4].data(), out[5].data(), out[4].data(), out[5].data(), len);
+        parallel->processStereo (left.data(), right.data(), out[6].data(), out[7].data(), len);
+        compact->processStereo (left.data(), right.data(), out[8].data(), out[9].data(), len);
+        for (int i = 0; i < len; ++i) {
+            worst.reference = std::max (worst.reference, std::max (std::abs (out[0][i] - out[2][i]), std::abs (out[1][i] - out[3][i])));
+            worst.inPlace   = std::max (worst.inPlace, std::max (std::abs (out[0][i] - out[4][i]), std::abs (out[1][i] - out[5][i])));
+            worst.parallel  = std::max (worst.parallel, std::max (std::abs (out[0][i] - out[6][i]), std::abs (out[1][i] - out[7][i])));
+            worst.compact   = std::max (worst.compact, std::max (std::abs (out[0][i] - out[8][i]), std::abs (out[1][i] - out[9][i])));
+            outputPower += (double) out[0][i] * out[0][i] + (double) out[1][i] * out[1][i];
+            compactPower += (double) (out[0][i] - out[8][i]) * (out[0][i] - out[8][i])
+                            + (double) (out[1][i] - out[9][i]) * (out[1][i] - out[9][i]);
+        }
+    }
+
+    worst.compactDb = 10.0 * std::log10 (outputPower / std::max (compactPower, 1.0e-30));
+    return worst;
+}
+
+/** Checks every available kernel set against the reference. */
+int verifyKernels() {
+    const roboverb::kernels::Kernels* kernels[8];
+    const int numKernels = roboverb::kernels::available (kernels, 8);
+    int numFailed        = 0;
+
+    for (int k = 0; k < numKernels; ++k) {
+        Verification worst;
+        worst.compactDb = 1000.0;
+        for (const double sampleRate : sampleRates) {
+            const Verification v = verifyKernel (*kernels[k], sampleRate, (unsigned) k + 1);
+            worst.reference      = std::max (worst.reference, v.reference);
+            worst.inPlace        = std::max (worst.inPlace, v.inPlace);
+            worst.parallel       = std::max (worst.parallel, v.parallel);
+            worst.compact        = std::max (worst.compact, v.compact);
+            worst.compactDb      = std::min (worst.compactDb, v.compactDb);
+        }
+
+        // the variants must match exactly: they run the same arithmetic on
+        // the same input in the same order
+        const bool passed = worst.reference <= kernelTolerance && worst.inPlace == 0.0f
+                            && worst.parallel == 0.0f && worst.compactDb >= compactMinimumDb;
+        numFailed += passed ? 0 : 1;
+        std::printf ("%-8s max difference %g, in place %g, parallel %g, half %g (%.1f dB down) %s\n",
+                     kernels[k]->name, worst.reference, worst.inPlace, worst.parallel,
+                     worst.compact, worst.compactDb, passed ? "ok" : "FAILED");
+    }
+
+    return numFailed > 0 ? 1 : 0;
+}
+
+/** Activates a reverb the way the plugins do: LV2 only sets the rate,
+    CLAP also sets the task runner.  Then renders a block,
+    which must not allocate either. */
+void activate (Roboverb& verb, const double sampleRate, const bool useTasks) {
+    verb.setSampleRate (sampleRate);
+    verb.setTaskRunner (useTasks ? &runTasksBackwards : nullptr, &verb, 1);
+
+    float left[256] {}, right[256] {};
+    left[0] = right[0] = 1.0f;
+    if (verb.getLayout() == Roboverb::Mono)
+        verb.processMono (left, 256);
+    else
+        verb.processStereo (left, right, left, right, 256);
+}
+
+/** Checks that once a reverb has been activated, activating it again at
+    any rate up to maxSampleRate, with or without a task runner, or
+    switching its internal rate, allocates nothing. */
+int verifyActivation() {
+    const double rates[] = { 8000.0, 22050.0, 44100.0, 48000.0, 64000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+    long worst           = 0;
+
+    for (const auto layout : { Roboverb::Stereo, Roboverb::Mono }) {
+        for (const bool reduce : { false, true }) {
+            auto verb = std::make_unique<Roboverb>();
+            verb->setLayout (layout);
+            verb->setReducedInternalRate (reduce);
+            activate (*verb, 44100.0, true);
+
+            const long before = numAllocations;
+            for (const double sampleRate : rates) {
+                for (const bool useTasks : { false, true })
+                    activate (*verb, sampleRate, useTasks);
+
+                // the plugins switch the internal rate from the audio thread
+                verb->setReducedInternalRate (! reduce);
+                verb->setReducedInternalRate (reduce);
+            }
+            worst = std::max (worst, numAllocations - before);
+        }
+    }
+
+    std::printf ("%-8s %ld allocations after the first activation %s\n", "activate", worst, worst == 0 ? "ok" : "FAILED");
+    return worst == 0 ? 0 : 1;
+}
+
+/** Renders `numBlocks` blocks of noise of random lengths through two
+    reverbs and returns the largest difference between their outputs.  With
+    `varied` set, the blocks also change settings as changeSettings() does
+    and every 13th is silent. */
+float renderBoth (Roboverb& a, Roboverb& b, std::mt19937& rng, const int numBlocks, const bool varied = false) {
+    std::uniform_real_distribution<float> unit (-0.5f, 0.5f);
+    std::vector<float> in[2], out[4];
+    for (auto& v : in)
+        v.resize (1500);
+    for (auto& v : out)
+        v.resize (1500);
+
+    float worst = 0;
+    for (int block = 0; block < numBlocks; ++block) {
+        const int len = 1 + (int) (rng() % 1500);
+        if (varied)
+            changeSettings ({ &a, &b }, rng, block);
+
+        const bool silent = varied && block % 13 == 0;
+        for (int i = 0; i < len; ++i) {
+            in[0][i] = silent ? 0.0f : unit (rng);
+            in[1][i] = silent ? 0.0f : unit (rng);
+        }
+
+        if (a.getLayout() == Roboverb::Mono) {
+            std::copy_n (in[0].data(), len, out[0].data());
+            std::copy_n (in[0].data(), len, out[2].data());
+            a.processMono (out[0].data(), len);
+            b.processMono (out[2].data(), len);
+            std::fill_n (out[1].data(), len, 0.0f);
+            std::fill_n (out[3].data(), len, 0.0f);
+        } else {
+            a.processStereo (in[0].data(), in[1].data(), out[0].data(), out[1].data(), len);
+            b.processStereo (in[0].data(), in[1].data(), out[2].data(), out[3].data(), len);
+        }
+
+        for (int i = 0; i < len; ++i)
+            worst = std::max (worst, std::max (std::abs (out[0][i] - out[2][i]), std::abs (out[1][i] - out[3][i])));
+    }
+
+    return worst;
+}
+
+/** Checks that reset(), which leaves the delay lines to be cleared as they
+    are reached, renders exactly what a reverb whose lines were cleared at
+    once by setSampleRate() does, in every layout and processing mode.  A
+    comb is off while the lines are filled and turned on partway through
+    clearing them, so the combs are re-packed with lines at different
+    stages of it. */
+int verifyReset() {
+    float worst = 0;
+    unsigned seed = 1;
+
+    for (const auto layout : { Roboverb::Stereo, Roboverb::Mono }) {
+        for (const bool reduce : { false, true }) {
+            for (const bool compact : { false, true }) {
+                for (const int mode : { 0, 1, 2 }) { // blocks, tasks, samples
+                    std::unique_ptr<Roboverb> verbs[2] = { std::make_unique<Roboverb> (layout), std::make_unique<Roboverb> (layout) };
+                    for (auto& verb : verbs) {
+                        verb->setReducedInternalRate (reduce);
+                        verb->setCompactStorage (compact);
+                        verb->setBlockProcessing (mode != 2);
+                        if (mode == 1)
+                            verb->setTaskRunner (&runTasksBackwards, verb.get(), 1);
+                        verb->setSampleRate (96000.0);
+
+                        Roboverb::Parameters params;
+                        params.roomSize = 0.9f;
+                        verb->setParameters (params);
+                        verb->setCombToggle (3, false);
+                    }
+
+                    std::mt19937 rng (seed++);
+                    renderBoth (*verbs[0], *verbs[1], rng, 60);
+
+                    verbs[0]->setSampleRate (96000.0);
+                    verbs[1]->reset();
+                    worst = std::max (worst, renderBoth (*verbs[0], *verbs[1], rng, 2));
+                    for (auto& verb : verbs) {
+                        verb->setCombToggle (3, true);
+                        verb->setCombToggle (1, false);
+                    }
+
+                    worst = std::max (worst, renderBoth (*verbs[0], *verbs[1], rng, 200));
+                }
+            }
+        }
+    }
+
+    std::printf ("%-8s max difference from a full clear %g %s\n", "reset", worst, worst == 0.0f ? "ok" : "FAILED");
+    return worst == 0.0f ? 0 : 1;
+}
+
+/** Checks that block processing, with each kernel set, renders what
+    sample-major processing does to within blockTolerance, in both
+    layouts, with automation, toggles and silence. */
+int verifyBlockProcessing() {
+    const roboverb::kernels::Kernels* kernels[8];
+    const int numKernels = roboverb::kernels::available (kernels, 8);
+    int numFailed        = 0;
+    unsigned seed        = 1;
+
+    for (const auto layout : { Roboverb::Stereo, Roboverb::Mono }) {
+        float worst = 0;
+        for (int k = 0; k < numKernels; ++k) {
+            for (const double sampleRate : sampleRates) {
+                Roboverb blocks (layout), samples (layout);
+                blocks.setKernels (*kernels[k]);
+                samples.setBlockProcessing (false);
+                blocks.setSampleRate (sampleRate);
+                samples.setSampleRate (sampleRate);
+
+                std::mt19937 rng (seed++);
+                worst = std::max (worst, renderBoth (blocks, samples, rng, 300, true));
+            }
+        }
+
+        const bool passed = worst <= blockTolerance;
+        numFailed += passed ? 0 : 1;
+        std::printf ("%-8s max difference of %s blocks from sample-major %g %s\n", "blocks",
+                     layout == Roboverb::Mono ? "mono" : "stereo", worst, passed ? "ok" : "FAILED");
+    }
+
+    return numFailed > 0 ? 1 : 0;
+}
+
+/** Checks every lane of a RoboverbBank, with each kernel set, against a
+    standalone sample-major Roboverb given the same settings and audio.
+    Each instance gets its own noise, parameters and toggles, so groups
+    run with filters on in some lanes only, and the last group is only
+    partly filled.  The bank runs the standalone reverbs' arithmetic, so
+    the difference has to stay within kernelTolerance, which leaves room
+    for fused multiply-adds. */
+int verifyBank() {
+    const roboverb::kernels::Kernels* kernels[8];
+    const int numKernels = roboverb::kernels::available (kernels, 8);
+    int numFailed        = 0;
+    unsigned seed        = 1;
+
+    for (int k = 0; k < numKernels; ++k) {
+        float worst = 0;
+        for (const double sampleRate : sampleRates) {
+            const int numInstances = 2 * kernels[k]->bank.lanes + 1;
+            RoboverbBank bank (numInstances, *kernels[k]);
+            bank.setSampleRate (sampleRate);
+
+            std::vector<std::unique_ptr<Roboverb>> verbs;
+            for (int i = 0; i < numInstances; ++i) {
+                verbs.push_back (std::make_unique<Roboverb>());
+                verbs.back()->setBlockProcessing (false);
+                verbs.back()->setSampleRate (sampleRate);
+            }
+
+            std::mt19937 rng (seed++);
+            std::uniform_real_distribution<float> unit (0.0f, 1.0f), noise (-0.5f, 0.5f);
+            std::vector<std::vector<float>> in[2], out[2], ref[2];
+            const float* inputs[2][64];
+            float* outputs[2][64];
+            for (int c = 0; c < 2; ++c) {
+                in[c].assign ((size_t) numInstances, std::vector<float> (1500));
+                out[c].assign ((size_t) numInstances, std::vector<float> (1500));
+                ref[c].assign ((size_t) numInstances, std::vector<float> (1500));
+                for (int i = 0; i < numInstances; ++i) {
+                    inputs[c][i]  = in[c][(size_t) i].data();
+                    outputs[c][i] = out[c][(size_t) i].data();
+                }
+            }
+
+            for (int block = 0; block < 200; ++block) {
+                const int len = 1 + (int) (rng() % 1500);
+                for (int i = 0; i < numInstances; ++i) {
+                    Roboverb& verb = *verbs[(size_t) i];
+                    if ((block + i) % 7 == 0) {
+                        Roboverb::Parameters params;
+                        params.roomSize   = unit (rng);
+                        params.damping    = unit (rng);
+                        params.wetLevel   = unit (rng);
+                        params.dryLevel   = unit (rng);
+                        params.width      = unit (rng);
+                        params.freezeMode = unit (rng) < 0.1f ? 1.0f : 0.0f;
+                        verb.setParameters (params);
+                        bank.setParameters (i, params);
+                    }
+                    if ((block + i) % 11 == 0) {
+                        const int comb = (int) (rng() % 8), allPass = (int) (rng() % 4);
+                        const bool on = (rng() & 1) != 0;
+                        verb.setCombToggle (comb, on);
+                        verb.setAllPassToggle (allPass, ! on);
+                        bank.setCombToggle (i, comb, on);
+                        bank.setAllPassToggle (i, allPass, ! on);
+                    }
+
+                    // a new Roboverb sleeps until its first sound, and a
+                    // sleeping one skips its smoothing rather than step it
+                    const bool silent = block > 0 && (block + i) % 13 == 0;
+                    for (int c = 0; c < 2; ++c)
+                        for (int n = 0; n < len; ++n)
+                            in[c][(size_t) i][(size_t) n] = silent ? 0.0f : noise (rng);
+
+                    verb.processStereo (const_cast<float*> (inputs[0][i]), const_cast<float*> (inputs[1][i]),
+                                        ref[0][(size_t) i].data(), ref[1][(size_t) i].data(), len);
+                }
+
+                bank.processStereo (inputs[0], inputs[1], outputs[0], outputs[1], len);
+
+                for (int c = 0; c < 2; ++c)
+                    for (int i = 0; i < numInstances; ++i)
+                        for (int n = 0; n < len; ++n)
+                            worst = std::max (worst, std::abs (out[c][(size_t) i][(size_t) n] - ref[c][(size_t) i][(size_t) n]));
+            }
+        }
+
+        const bool passed = worst <= kernelTolerance;
+        numFailed += passed ? 0 : 1;
+        std::printf ("%-8s max difference of bank lanes from standalone %g %s\n",
+                     kernels[k]->name, worst, passed ? "ok" : "FAILED");
+    }
+
+    return numFailed > 0 ? 1 : 0;
+}
+
+/** Checks that double precision I/O renders what float I/O does to
+    within kernelTolerance, in both layouts, with automation, toggles and
+    silence.  Only the mix runs at double precision, so the two differ by
+    its rounding. */
+int verifyDoublePrecision() {
+    int numFailed = 0;
+    unsigned seed = 1;
+
+    for (const auto layout : { Roboverb::Stereo, Roboverb::Mono }) {
+        float worst = 0;
+        for (const double sampleRate : sampleRates) {
+            Roboverb single (layout), twice (layout);
+            single.setSampleRate (sampleRate);
+            twice.setSampleRate (sampleRate);
+
+            std::mt19937 rng (seed++);
+            std::uniform_real_distribution<float> unit (-0.5f, 0.5f);
+            std::vector<float> in[2], out[2];
+            std::vector<double> in64[2], out64[2];
+            for (int c = 0; c < 2; ++c) {
+                in[c].resize (1500);
+                out[c].resize (1500);
+                in64[c].resize (1500);
+                out64[c].resize (1500);
+            }
+
+            for (int block = 0; block < 300; ++block) {
+                const int len = 1 + (int) (rng() % 1500);
+                changeSettings ({ &single, &twice }, rng, block);
+
+                const bool silent = block % 13 == 0;
+                for (int c = 0; c < 2; ++c) {
+                    for (int i = 0; i < len; ++i) {
+                        in[c][i]   = silent ? 0.0f : unit (rng);
+                        in64[c][i] = in[c][i];
+                    }
+                }
+
+                if (layout == Roboverb::Mono) {
+                    std::copy_n (in[0].data(), len, out[0].data());
+                    std::copy_n (in64[0].data(), len, out64[0].data());
+                    single.processMono (out[0].data(), len);
+                    twice.processMono (out64[0].data(), len);
+                    std::fill_n (out[1].data(), len, 0.0f);
+                    std::fill_n (out64[1].data(), len, 0.0);
+                } else {
+                    single.processStereo (in[0].data(), in[1].data(), out[0].data(), out[1].data(), len);
+                    twice.processStereo (in64[0].data(), in64[1].data(), out64[0].data(), out64[1].data(), len);
+                }
+
+                for (int c = 0; c < 2; ++c)
+                    for (int i = 0; i < len; ++i)
+                        worst = std::max (worst, (float) std::abs (out64[c][i] - out[c][i]));
+            }
+        }
+
+        const bool passed = worst <= kernelTolerance;
+        numFailed += passed ? 0 : 1;
+        std::printf ("%-8s max difference of %s double I/O from float %g %s\n", "double",
+                     layout == Roboverb::Mono ? "mono" : "stereo", worst, passed ? "ok" : "FAILED");
+    }
+
+    return numFailed > 0 ? 1 : 0;
+}
+
+/** Runs `samples` through four one-pole lowpass filters at `cutoff` Hz,
+    in place. */
+void lowpass (std::vector<float>& samples, const double cutoff, const double sampleRate) {
+    const float a = (float) std::exp (-2.0 * 3.14159265358979323846 * cutoff / sampleRate);
+    for (int pass = 0; pass < 4; ++pass) {
+        float y = 0;
+        for (auto& x : samples)
+            x = y = x + a * (y - x);
+    }
+}
+
+/** Checks a reverb running its network at a reduced internal rate against
+    one running at full rate, stereo and mono, at 96 and 192 kHz.  Both
+    render a burst of noise below reducedCutoff, wet only and undamped,
+    since the damping filter acts per network sample.  The wet levels have to agree to within
+    reducedMaximumLevelDb, and below reducedCutoff Hz, once the
+    resamplers' delay is taken out, the difference has to stay
+    reducedMinimumDb under the output.  Rendering the channels as tasks
+    has to stay within blockTolerance of rendering them serially. */
+int verifyReducedRate() {
+    int numFailed = 0;
+
+    for (const auto layout : { Roboverb::Stereo, Roboverb::Mono }) {
+        for (const double sampleRate : { 96000.0, 192000.0 }) {
+            Roboverb full (layout), reduced (layout), parallel (layout);
+            reduced.setReducedInternalRate (true);
+            parallel.setReducedInternalRate (true);
+            parallel.setTaskRunner (&runTasksBackwards, &parallel, 1);
+
+            Roboverb::Parameters params;
+            params.roomSize = 0.5f;
+            params.damping  = 0.0f;
+            params.wetLevel = 1.0f;
+            params.dryLevel = 0.0f;
+            params.width    = 1.0f;
+            for (auto* verb : { &full, &reduced, &parallel }) {
+                verb->setSampleRate (sampleRate);
+                verb->setParameters (params);
+            }
+
+            const int blockSize = 512, numFrames = (int) (sampleRate / 2) / blockSize * blockSize;
+            // band-limited, so the full rate reverb has nothing the
+            // resamplers would take away
+            std::vector<float> noise = makeNoise ((size_t) sampleRate / 100, 3);
+            lowpass (noise, reducedCutoff, sampleRate);
+            std::vector<float> in[2], out[3][2];
+            for (auto& v : in)
+                v.resize (blockSize);
+            for (auto& o : out)
+                for (auto& v : o)
+                    v.resize ((size_t) numFrames);
+
+            float tasks = 0;
+            for (int pos = 0; pos < numFrames; pos += blockSize) {
+                for (int i = 0; i < blockSize; ++i)
+                    in[0][i] = in[1][i] = pos + i < (int) noise.size() ? noise[(size_t) (pos + i)] : 0.0f;
+
+                Roboverb* const verbs[] = { &full, &reduced, &parallel };
+                for (int v = 0; v < 3; ++v) {
+                    float* const out1 = out[v][0].data() + pos;
+                    float* const out2 = out[v][1].data() + pos;
+                    if (layout == Roboverb::Mono) {
+                        std::copy_n (in[0].data(), blockSize, out1);
+                        verbs[v]->processMono (out1, blockSize);
+                    } else {
+                        verbs[v]->processStereo (in[0].data(), in[1].data(), out1, out2, blockSize);
+                    }
+                }
+            }
+
+            double levelDb = 0, differenceDb = 1000.0;
+            int worstLag   = 0;
+            for (int c = 0; c < (layout == Roboverb::Mono ? 1 : 2); ++c) {
+                for (int i = 0; i < numFrames; ++i)
+                    tasks = std::max (tasks, std::abs (out[1][c][(size_t) i] - out[2][c][(size_t) i]));
+
+                double fullPower = 0, reducedPower = 0;
+                for (int i = 0; i < numFrames; ++i) {
+                    fullPower += (double) out[0][c][(size_t) i] * out[0][c][(size_t) i];
+                    reducedPower += (double) out[1][c][(size_t) i] * out[1][c][(size_t) i];
+                }
+                const double db = 10.0 * std::log10 (reducedPower / fullPower);
+                levelDb         = std::abs (db) > std::abs (levelDb) ? db : levelDb;
+
+                lowpass (out[0][c], reducedCutoff, sampleRate);
+                lowpass (out[1][c], reducedCutoff, sampleRate);
+
+                // the reduced output lags by the resamplers' group delay
+                double lowPower = 0, bestDifference = 0;
+                int bestLag     = 0;
+                for (int lag = 0; lag <= 64; ++lag) {
+                    double power = 0, difference = 0;
+                    for (int i = 0; i + lag < numFrames; ++i) {
+                        const double x = out[0][c][(size_t) i], d = out[1][c][(size_t) (i + lag)] - x;
+                        power += x * x;
+                        difference += d * d;
+                    }
+                    if (lag == 0 || difference < bestDifference) {
+                        bestDifference = difference;
+                        bestLag        = lag;
+                        lowPower       = power;
+                    }
+                }
+
+                differenceDb = std::min (differenceDb, 10.0 * std::log10 (lowPower / std::max (bestDifference, 1.0e-30)));
+                worstLag     = std::max (worstLag, bestLag);
+            }
+
+            const bool passed = std::abs (levelDb) <= reducedMaximumLevelDb && differenceDb >= reducedMinimumDb
+                                && tasks <= blockTolerance;
+            numFailed += passed ? 0 : 1;
+            std::printf ("%-8s %s %d: level %+.2f dB, difference below %g Hz %.1f dB down at a lag of %d, tasks %g %s\n",
+                         "reduced", layout == Roboverb::Mono ? "mono" : "stereo", (int) sampleRate, levelDb,
+                         reducedCutoff, differenceDb, worstLag, tasks, passed ? "ok" : "FAILED");
+        }
+    }
+
+    return numFailed > 0 ? 1 : 0;
+}
+
+void writeJson (std::FILE* out, const std::vector<Result>& results) {
+    std::fprintf (out, "{\n  \"kernel\": \"%s\",\n  \"results\": [\n", roboverb::kernels::select().name);
+    for (size_t i = 0; i < results.size(); ++i) {
+        std::fprintf (out, "    { \"name\": \"%s\", \"unit\": \"%s\", \"value\": %.3f }%s\n",
+                      results[i].name.c_str(),
+                      results[i].unit,
+                      results[i].value,
+                      i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf (out, "  ]\n}\n");
+}
+
+/** Reads the name/value pairs back from a file written by writeJson(). */
+std::map<std::string, double> readJson (const char* path) {
+    std::map<std::string, double> values;
+    std::FILE* const in = std::fopen (path, "rb");
+    if (in == nullptr)
+        return values;
+
+    std::string text;
+    char chunk[4096];
+    for (size_t n; (n = std::fread (chunk, 1, sizeof (chunk), in)) > 0;)
+        text.append (chunk, n);
+    std::fclose (in);
+
+    const std::string nameKey = "\"name\": \"", valueKey = "\"value\": ";
+    for (size_t pos = 0; (pos = text.find (nameKey, pos)) != std::string::npos;) {
+        pos += nameKey.size();
+        const size_t end   = text.find ('"', pos);
+        const size_t value = text.find (valueKey, end);
+        if (end == std::string::npos || value == std::string::npos)
+            break;
+        values[text.substr (pos, end - pos)] = std::strtod (text.c_str() + value + valueKey.size(), nullptr);
+        pos                                  = value;
+    }
+
+    return values;
+}
+
+/** Prints how every case changed against the baseline and returns the
+    number of cases that slowed down by more than thresholdPercent. */
+int compare (const std::vector<Result>& results, const std::map<std::string, double>& baseline,
+             const double thresholdPercent) {
+    int numRegressions = 0;
+    std::fprintf (stderr, "%-48s %12s %12s %9s\n", "case", "baseline", "current", "change");
+
+    for (const auto& result : results) {
+        const auto found = baseline.find (result.name);
+        if (found == baseline.end() || found->second <= 0.0)
+            continue;
+
+        const double change   = 100.0 * (result.value - found->second) / found->second;
+        const bool regression = change > thresholdPercent;
+        numRegressions += regression ? 1 : 0;
+        std::fprintf (stderr, "%-48s %12.3f %12.3f %+8.1f%%%s\n",
+                      result.name.c_str(), found->second, result.value, change,
+                      regression ? "  REGRESSION" : "");
+    }
+
+    return numRegressions;
+}
+
+} // namespace
+
+int main (int argc, char** argv) {
+    std::string filter;
+    const char* outputPath   = nullptr;
+    const char* baselinePath = nullptr;
+    double thresholdPercent  = 10.0;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--filter")
+            filter = argv[++i];
+        else if (i + 1 < argc && arg == "--output")
+            outputPath = argv[++i];
+        else if (i + 1 < argc && arg == "--compare")
+            baselinePath = argv[++i];
+        else if (i + 1 < argc && arg == "--threshold")
+            thresholdPercent = std::atof (argv[++i]);
+        else if (arg == "--verify") {
+            const int kernelsFailed    = verifyKernels();
+            const int activationFailed = verifyActivation();
+            const int resetFailed      = verifyReset();
+            const int blocksFailed     = verifyBlockProcessing();
+            const int bankFailed       = verifyBank();
+            const int doubleFailed     = verifyDoublePrecision();
+            return std::max ({ kernelsFailed, activationFailed, resetFailed, blocksFailed, bankFailed,
+                               doubleFailed, verifyReducedRate() });
+        } else {
+            std::fprintf (stderr, "usage: roboverb-bench [--filter TEXT] [--output FILE] [--compare FILE] [--threshold PERCENT]\n"
+                                  "       roboverb-bench --verify\n");
+            return 2;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (baselinePath != nullptr) {
+        baseline = readJson (baselinePath);
+        if (baseline.empty()) {
+            std::fprintf (stderr, "roboverb-bench: no results in %s\n", baselinePath);
+            return 2;
+        }
+    }
+
+    const std::vector<Result> results = runCases (filter);
+
+    std::FILE* const out = outputPath != nullptr ? std::fopen (outputPath, "w") : stdout;
+    if (out == nullptr) {
+        std::fprintf (stderr, "roboverb-bench: cannot write %s\n", outputPath);
+        return 2;
+    }
+    writeJson (out, results);
+    if (out != stdout)
+        std::fclose (out);
+
+    if (baselinePath != nullptr && compare (results, baseline, thresholdPercent) > 0)
+        return 1;
+
+    return 0;
+}
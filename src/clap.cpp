@@ -17,12 +17,14 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <atomic>
 #include <clap/helpers/plugin.hh>
 #include <cstring>
 #include <iostream>
 #include <sstream>
 
+#include "./denormals.hpp"
 #include "./ports.hpp"
 #include "./roboverb.hpp"
 #include "./ui.hpp"
@@ -55,6 +57,87 @@ namespace roboverb {
 using BaseType = clap::helpers::Plugin<clap::helpers::MisbehaviourHandler::Terminate,
                                        clap::helpers::CheckingLevel::Maximal>;
 
+/** Size state shared between threads is padded to, so data one thread
+    writes never shares a cache line with data another thread writes. */
+static constexpr size_t cacheLineSize = 64;
+
+/** Carries parameter values from the main/GUI thread to the audio thread.
+    Each parameter has a slot holding its latest value and a bit in a dirty
+    mask; the audio thread takes the whole mask at once.  Neither side ever
+    waits, and repeated posts of one parameter collapse into one.  Every
+    post also counts up a sequence, so the main thread can tell which posts
+    the audio thread has taken. */
+class ParamMailbox {
+public:
+    void post (const uint32_t index, const float value) noexcept {
+        values[index].store (value, std::memory_order_relaxed);
+        dirty.fetch_or (1u << index, std::memory_order_release);
+        sequence.fetch_add (1, std::memory_order_release);
+    }
+
+    /** Returns the sequence of the last post() made. */
+    uint32_t posted() const noexcept { return sequence.load (std::memory_order_relaxed); }
+
+    /** Calls fn (index, value) for every parameter posted since the last
+        call, and returns the sequence up to which every post was taken. */
+    template <class Fn>
+    uint32_t collect (Fn&& fn) noexcept {
+        const uint32_t taken = sequence.load (std::memory_order_acquire);
+        const uint32_t bits  = dirty.exchange (0, std::memory_order_acquire);
+        for (uint32_t index = 0; bits >> index != 0; ++index)
+            if ((bits >> index) & 1u)
+                fn (index, values[index].load (std::memory_order_relaxed));
+        return taken;
+    }
+
+private:
+    static_assert (Ports::numParams() <= 32, "one dirty bit per parameter");
+    std::atomic<uint32_t> dirty { 0 };
+    std::atomic<uint32_t> sequence { 0 };
+    std::atomic<float> values[Ports::numParams()] {};
+};
+
+/** Carries the values of every parameter from the audio thread to the main
+    thread, along with the last mailbox sequence they include.  The audio
+    thread is the only writer and never waits; readers retry if a write
+    overlapped their copy. */
+class ParamSnapshot {
+public:
+    void publish (const float* const newValues, const uint32_t newTaken) noexcept {
+        const uint32_t seq = sequence.load (std::memory_order_relaxed);
+        sequence.store (seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+        for (uint32_t i = 0; i < Ports::numParams(); ++i)
+            values[i].store (newValues[i], std::memory_order_relaxed);
+        taken.store (newTaken, std::memory_order_relaxed);
+        sequence.store (seq + 2, std::memory_order_release);
+    }
+
+    /** Returns a number that changes with every publish(). */
+    uint32_t version() const noexcept { return sequence.load (std::memory_order_acquire); }
+
+    /** Copies a consistent set of values and the mailbox sequence they
+        include, and returns their version. */
+    uint32_t read (float* const dest, uint32_t& destTaken) const noexcept {
+        for (;;) {
+            const uint32_t before = sequence.load (std::memory_order_acquire);
+            if (before & 1u)
+                continue;
+            for (uint32_t i = 0; i < Ports::numParams(); ++i)
+                dest[i] = values[i].load (std::memory_order_relaxed);
+            destTaken = taken.load (std::memory_order_relaxed);
+            std::atomic_thread_fence (std::memory_order_acquire);
+            if (sequence.load (std::memory_order_relaxed) == before)
+                return before;
+        }
+    }
+
+private:
+    std::atomic<uint32_t> sequence { 0 };
+    std::atomic<float> values[Ports::numParams()] {};
+    std::atomic<uint32_t> taken { 0 };
+};
+
 class Plugin : public BaseType {
 public:
     Plugin (const clap_host* host) : BaseType (&sDescriptor, host) {
@@ -70,14 +153,14 @@ protected:
 
         const Roboverb::Parameters defaults;
         _verb.setParameters (defaults);
-        _uiParams = _rtParams = defaults;
+        _rtParams = defaults;
         _verb.reset();
 
-        for (uint32_t id = Ports::Wet; id <= Ports::AllPass_4; ++id) {
+        for (uint32_t id = Ports::Wet; id <= Ports::ReducedRate; ++id) {
             clap_param_info_t param;
             std::strcpy (param.module, "Reverb");
             param.cookie    = nullptr;
-            param.flags     = 0;
+            param.flags     = id <= Ports::Width ? CLAP_PARAM_IS_MODULATABLE : 0;
             param.id        = id;
             param.min_value = 0.0;
             param.max_value = 1.0;
@@ -125,15 +208,31 @@ protected:
                     param.default_value = _verb.toggledAllPassFloat (index);
                     break;
                 }
+
+                case Ports::ReducedRate:
+                    std::strcpy (param.name, "Reduced Rate");
+                    // clears the delay lines, so it's left to the user
+                    // rather than offered for automation
+                    param.flags         = CLAP_PARAM_REQUIRES_PROCESS;
+                    param.default_value = _verb.hasReducedInternalRate() ? 1.0 : 0.0;
+                    break;
             }
 
+            _rtValues[id - Ports::paramsBegin()] = static_cast<float> (param.default_value);
             _paramInfo.push_back (param);
         }
+
+        _rtTaken = _fromMain.posted();
+        _toMain.publish (_rtValues, _rtTaken);
+        refreshFromAudio();
+        publishTail();
         return true;
     }
 
     bool activate (double sampleRate, uint32_t minFrameCount, uint32_t maxFrameCount) noexcept override {
         _verb.setSampleRate (sampleRate);
+        _verb.setTaskRunner (_host->canUseThreadPool() ? &Plugin::runTasks : nullptr, this);
+        publishTail();
         _doUpdate.store (1);
         return true;
     }
@@ -144,7 +243,13 @@ protected:
     }
     void stopProcessing() noexcept override {}
 
+    /** Sets a parameter on the reverb.  Only called from the audio thread,
+        or from the main thread while the plugin is inactive. */
     void update (clap_id id, double value) noexcept {
+        if (id < Ports::paramsBegin() || id >= Ports::paramsEnd())
+            return;
+        _rtValues[id - Ports::paramsBegin()] = static_cast<float> (value);
+
         switch (id) {
             case Ports::Damping:
                 _rtParams.damping = static_cast<float> (value);
@@ -183,6 +288,11 @@ protected:
                 _verb.setAllPassToggle (index, value);
                 break;
             }
+
+            // re-slices the delay lines, without allocating
+            case Ports::ReducedRate:
+                _verb.setReducedInternalRate (value > 0.0);
+                break;
         }
     }
 
@@ -190,38 +300,299 @@ protected:
         update (ev->param_id, ev->value);
     }
 
+    /** Sets the modulation offset of a continuous parameter, returning true
+        if it changed.  Each amount replaces the previous one and never
+        touches the parameter value.  Modulation aimed at a note, key or
+        channel is ignored: the reverb has no voices. */
+    bool modulate (const clap_event_param_mod_t* ev) noexcept {
+        if (ev->note_id != -1 || ev->key != -1 || ev->channel != -1)
+            return false;
+        if (ev->param_id < Ports::Wet || ev->param_id > Ports::Width)
+            return false;
+
+        float& offset      = _modulation[ev->param_id - Ports::Wet];
+        const float amount = static_cast<float> (ev->amount);
+        const bool changed = offset != amount;
+        offset             = amount;
+        return changed;
+    }
+
+    /** Takes the latest modulation amount of every parameter in the block
+        and hands the result to the reverb once, before anything renders.
+        Modulation never splits the block, so a dense stream of it costs
+        one parameter update per block, the same as automating once per
+        block; the smoothers ramp across the block instead. */
+    void foldModulation (const clap_input_events* events, const uint32_t numEvents) noexcept {
+        bool changed = false;
+        for (uint32_t i = 0; i < numEvents; ++i) {
+            const auto ev = events->get (events, i);
+            if (ev->space_id == CLAP_CORE_EVENT_SPACE_ID && ev->type == CLAP_EVENT_PARAM_MOD)
+                changed |= modulate ((const clap_event_param_mod_t*) ev);
+        }
+
+        if (changed)
+            applyParameters();
+    }
+
+    /** Hands the parameters plus modulation to the reverb, whose smoothers
+        ramp to the result. */
+    void applyParameters() noexcept {
+        const auto modulated = [this] (const float value, const uint32_t id) {
+            return std::min (1.0f, std::max (0.0f, value + _modulation[id - Ports::Wet]));
+        };
+
+        Roboverb::Parameters params = _rtParams;
+        params.wetLevel             = modulated (params.wetLevel, Ports::Wet);
+        params.dryLevel             = modulated (params.dryLevel, Ports::Dry);
+        params.roomSize             = modulated (params.roomSize, Ports::RoomSize);
+        params.damping              = modulated (params.damping, Ports::Damping);
+        params.width                = modulated (params.width, Ports::Width);
+        _verb.setParameters (params);
+    }
+
+    /** Applies one input event, returning true if it changed a parameter.
+        PARAM_MOD events are left to foldModulation(). */
+    bool handleEvent (const clap_event_header_t* ev) noexcept {
+        if (ev->space_id != CLAP_CORE_EVENT_SPACE_ID)
+            return false;
+
+        switch (ev->type) {
+            case CLAP_EVENT_PARAM_VALUE:
+                update ((const clap_event_param_value_t*) ev);
+                return true;
+        }
+
+        return false;
+    }
+
+    /** Returns the frame the block has to be split at after `pos`: the
+        frame of the next PARAM_VALUE event, so automation lands on its
+        frame.  Only events sharing a frame are coalesced, by
+        handleEvents(). */
+    uint32_t nextSplit (const clap_input_events* events, uint32_t next, const uint32_t numEvents,
+                        const uint32_t pos, const uint32_t nframes) const noexcept {
+        for (; next < numEvents; ++next) {
+            const auto ev = events->get (events, next);
+            if (ev->time >= nframes)
+                break;
+            if (ev->space_id != CLAP_CORE_EVENT_SPACE_ID)
+                continue;
+
+            if (ev->type == CLAP_EVENT_PARAM_VALUE)
+                return std::max (ev->time, pos + 1);
+        }
+
+        return nframes;
+    }
+
+    /** Applies every event up to and including frame `time`, starting at
+        `next`.  Events sharing a timestamp are coalesced into a single
+        parameter update.  Returns the index of the first event left. */
+    uint32_t handleEvents (const clap_input_events* events, uint32_t next, const uint32_t numEvents,
+                           const uint32_t time, bool& paramChanged) noexcept {
+        bool changed = false;
+        for (; next < numEvents; ++next) {
+            const auto ev = events->get (events, next);
+            if (ev->time > time)
+                break;
+            changed |= handleEvent (ev);
+        }
+
+        if (changed) {
+            applyParameters();
+            paramChanged = true;
+        }
+
+        return next;
+    }
+
     clap_process_status process (const clap_process* process) noexcept override {
-        auto num_in = process->in_events->size (process->in_events);
-
-        bool paramChanged = false;
-        for (uint32_t i = 0; i < num_in; ++i) {
-            auto ev = process->in_events->get (process->in_events, i);
-            switch (ev->type) {
-                case CLAP_EVENT_PARAM_VALUE: {
-                    update ((const clap_event_param_value_t*) ev);
-                    paramChanged = true;
-                    break;
-                }
+        const roboverb::ScopedNoDenormals noDenormals;
+
+        const auto events    = process->in_events;
+        const auto numEvents = events->size (events);
+
+        const auto& in     = process->audio_inputs[0];
+        auto& out          = process->audio_outputs[0];
+        const auto nframes = static_cast<int> (process->frames_count);
+
+        bool paramChanged = collectFromMain (process->out_events);
+        uint32_t next     = 0;
+        foldModulation (events, numEvents);
+
+        // A constant zero input to a sleeping reverb leaves nothing to render,
+        // so the events can all be applied up front.
+        const uint64_t inMask  = (uint64_t (1) << in.channel_count) - 1;
+        const uint64_t outMask = (uint64_t (1) << out.channel_count) - 1;
+        bool quiet             = (in.constant_mask & inMask) == inMask;
+        for (uint32_t c = 0; quiet && c < in.channel_count; ++c)
+            quiet = in.data64 != nullptr ? in.data64[c][0] == 0.0 : in.data32[c][0] == 0.0f;
+        if (quiet && _verb.isSleeping()) {
+            handleEvents (events, next, numEvents, UINT32_MAX, paramChanged);
+            _verb.skipSilence (nframes);
+            publishParameters (paramChanged);
+            // every frame, for hosts that don't look at constant_mask
+            for (uint32_t c = 0; c < out.channel_count; ++c) {
+                if (out.data64 != nullptr)
+                    std::fill_n (out.data64[c], nframes, 0.0);
+                else
+                    std::fill_n (out.data32[c], nframes, 0.0f);
             }
+            out.constant_mask = outMask;
+            return CLAP_PROCESS_SLEEP;
         }
 
-        if (paramChanged) {
-            _verb.setParameters (_rtParams);
-            std::lock_guard<std::mutex> sl (paramMutex);
-            _uiParams = _rtParams;
-            _doUpdate.store (1);
+        // Render up to each event's timestamp, then apply it, so automation
+        // lands on the frame the host placed it at.
+        for (int pos = 0; pos < nframes;) {
+            next = handleEvents (events, next, numEvents, static_cast<uint32_t> (pos), paramChanged);
+
+            const int end = static_cast<int> (nextSplit (events, next, numEvents,
+                                                         static_cast<uint32_t> (pos),
+                                                         static_cast<uint32_t> (nframes)));
+
+            if (out.data64 != nullptr)
+                render (in.data64, out.data64, pos, end - pos);
+            else
+                render (in.data32, out.data32, pos, end - pos);
+            pos = end;
+        }
+
+        // events stamped past the end of the block still take effect
+        handleEvents (events, next, numEvents, UINT32_MAX, paramChanged);
+        publishParameters (paramChanged);
+        out.constant_mask = 0;
+
+        return _verb.isSleeping() ? CLAP_PROCESS_SLEEP : CLAP_PROCESS_CONTINUE;
+    }
+
+    /** Runs frames [pos, pos + len) through the reverb in the selected port
+        configuration.  The ports require a common sample size, so the host
+        picks 32 or 64-bit buffers for both. */
+    template <typename Sample>
+    void render (Sample* const* const ins, Sample* const* const outs,
+                 const int pos, const int len) noexcept {
+        Sample* const input = ins[0] + pos;
+        Sample* const out1  = outs[0] + pos;
+
+        switch (_portConfig) {
+            case MonoToMono:
+                if (out1 != input)
+                    std::copy_n (input, len, out1);
+                _verb.processMono (out1, len);
+                break;
+
+            case MonoToStereo: {
+                // copied to both outputs first, so the input may share a
+                // buffer with either of them
+                Sample* const out2 = outs[1] + pos;
+                if (out1 != input)
+                    std::copy_n (input, len, out1);
+                if (out2 != input)
+                    std::copy_n (input, len, out2);
+                _verb.processStereo (out1, out2, out1, out2, len);
+                break;
+            }
+
+            default:
+                _verb.processStereo (input, ins[1] + pos, out1, outs[1] + pos, len);
+                break;
         }
+    }
 
-        _verb.processStereo (process->audio_inputs[0].data32[0],
-                             process->audio_inputs[0].data32[1],
-                             process->audio_outputs[0].data32[0],
-                             process->audio_outputs[0].data32[1],
-                             static_cast<int> (process->frames_count));
+    /** Lets the GUI and host know the parameters changed this block. */
+    void publishParameters (const bool paramChanged) noexcept {
+        if (! paramChanged)
+            return;
+
+        _toMain.publish (_rtValues, _rtTaken);
+        publishTail();
+        _doUpdate.store (1);
+
+        if (isActive() && _host->canUseTail())
+            _host->tailChanged();
+    }
+
+    /** Stores the tail length for tailGet(), which the host calls on the
+        main thread.  Called wherever the reverb's state may have changed:
+        by the audio thread, or by the main thread while inactive. */
+    void publishTail() noexcept {
+        const int length = _verb.getTailLength();
+        _tail.store (length < 0 ? static_cast<uint32_t> (INT32_MAX) : static_cast<uint32_t> (length),
+                     std::memory_order_relaxed);
+    }
+
+    /** Applies the values the main thread posted since the last block and
+        echoes them to the host, so they are recorded like any other
+        parameter change.  Also returns true when posts were taken without
+        changing anything, so the snapshot tells the main thread they were. */
+    bool collectFromMain (const clap_output_events* out) noexcept {
+        bool changed         = false;
+        const uint32_t taken = _fromMain.collect ([&] (const uint32_t index, const float value) {
+            const clap_id id = Ports::paramsBegin() + index;
+            update (id, value);
+            changed = true;
+
+            clap_event_param_value_t ev;
+            ev.header.size     = sizeof (ev);
+            ev.header.time     = 0;
+            ev.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+            ev.header.type     = CLAP_EVENT_PARAM_VALUE;
+            ev.header.flags    = 0;
+            ev.param_id        = id;
+            ev.cookie          = nullptr;
+            ev.note_id         = -1;
+            ev.port_index      = -1;
+            ev.channel         = -1;
+            ev.key             = -1;
+            ev.value           = value;
+            if (out != nullptr)
+                out->try_push (out, &ev.header);
+        });
+
+        if (changed)
+            applyParameters();
+        if (taken == _rtTaken)
+            return changed;
+        _rtTaken = taken;
+        return true;
+    }
+
+    /** Queues a parameter change made on the main thread.  The audio thread
+        applies it; the main thread's own view updates right away. */
+    void postFromMain (const clap_id id, const double value) noexcept {
+        if (id < Ports::paramsBegin() || id >= Ports::paramsEnd())
+            return;
+        _fromMain.post (id - Ports::paramsBegin(), static_cast<float> (value));
+        _uiValues[id - Ports::paramsBegin()] = static_cast<float> (value);
+    }
+
+    /** Gets posted changes applied even if no audio is being processed. */
+    void requestFlush() noexcept {
+        if (_host->canUseParams())
+            _host->paramsRequestFlush();
+        else if (! isActive())
+            publishParameters (collectFromMain (nullptr));
+    }
+
+    /** Picks up anything the audio thread published since the last look.
+        While the audio thread hasn't taken every post yet, its snapshot is
+        older than the main thread's own view, so it's left for later. */
+    void refreshFromAudio() noexcept {
+        if (_toMain.version() == _uiVersion)
+            return;
+
+        float values[Ports::numParams()];
+        uint32_t taken         = 0;
+        const uint32_t version = _toMain.read (values, taken);
+        if (taken != _fromMain.posted())
+            return;
 
-        return CLAP_PROCESS_CONTINUE;
+        std::copy (values, values + Ports::numParams(), _uiValues);
+        _uiVersion = version;
     }
 
-    void reset() noexcept override {}
+    void reset() noexcept override { _verb.reset(); }
     void onMainThread() noexcept override {}
     const void* extension (const char* id) noexcept override {
         (void) id;
@@ -235,15 +606,74 @@ protected:
     bool implementsAudioPorts() const noexcept override { return true; }
     uint32_t audioPortsCount (bool isInput) const noexcept override { return 1; }
     bool audioPortsInfo (uint32_t index, bool isInput, clap_audio_port_info* info) const noexcept override {
+        const bool stereo = isInput ? _portConfig == StereoToStereo : _portConfig != MonoToMono;
         std::strcpy (info->name, "Audio");
         info->id            = index;
-        info->channel_count = 2;
-        info->flags         = 0;
-        info->in_place_pair = CLAP_INVALID_ID;
-        info->port_type     = CLAP_PORT_STEREO;
+        info->channel_count = stereo ? 2 : 1;
+        info->flags         = CLAP_AUDIO_PORT_IS_MAIN | CLAP_AUDIO_PORT_SUPPORTS_64BITS
+                      | CLAP_AUDIO_PORT_REQUIRES_COMMON_SAMPLE_SIZE;
+        info->in_place_pair = _portConfig == MonoToStereo ? CLAP_INVALID_ID : index;
+        info->port_type     = stereo ? CLAP_PORT_STEREO : CLAP_PORT_MONO;
         return true;
     }
 
+    //--------------------------------//
+    // clap_plugin_audio_ports_config //
+    //--------------------------------//
+    bool implementsAudioPortsConfig() const noexcept override { return true; }
+    uint32_t audioPortsConfigCount() const noexcept override { return numPortConfigs; }
+    bool audioPortsGetConfig (uint32_t index, clap_audio_ports_config* config) const noexcept override {
+        static const char* const names[numPortConfigs] = { "Stereo", "Mono", "Mono to Stereo" };
+        if (index >= numPortConfigs)
+            return false;
+
+        config->id = index;
+        std::strcpy (config->name, names[index]);
+        config->input_port_count          = 1;
+        config->output_port_count         = 1;
+        config->has_main_input            = true;
+        config->main_input_channel_count  = index == StereoToStereo ? 2 : 1;
+        config->main_input_port_type      = index == StereoToStereo ? CLAP_PORT_STEREO : CLAP_PORT_MONO;
+        config->has_main_output           = true;
+        config->main_output_channel_count = index == MonoToMono ? 1 : 2;
+        config->main_output_port_type     = index == MonoToMono ? CLAP_PORT_MONO : CLAP_PORT_STEREO;
+        return true;
+    }
+
+    /** Only called while inactive.  Mono to mono runs only the left delay
+        network, which needs half the delay memory. */
+    bool audioPortsSetConfig (clap_id configId) noexcept override {
+        if (configId >= numPortConfigs)
+            return false;
+
+        _portConfig = configId;
+        _verb.setLayout (configId == MonoToMono ? Roboverb::Mono : Roboverb::Stereo);
+        return true;
+    }
+
+    //-------------------------//
+    // clap_plugin_thread_pool //
+    //-------------------------//
+    bool implementsThreadPool() const noexcept override { return true; }
+    void threadPoolExec (uint32_t taskIndex) noexcept override {
+        // pool threads don't inherit the audio thread's floating point mode
+        const roboverb::ScopedNoDenormals noDenormals;
+        _verb.runTask (static_cast<int> (taskIndex));
+    }
+
+    /** Hands the left and right networks to the host's thread pool.  When
+        the host declines, the reverb renders them itself. */
+    static bool runTasks (void* context, int numTasks) {
+        auto* const self = static_cast<Plugin*> (context);
+        return self->_host->threadPoolRequestExec (static_cast<uint32_t> (numTasks));
+    }
+
+    //------------------//
+    // clap_plugin_tail //
+    //------------------//
+    bool implementsTail() const noexcept override { return true; }
+    uint32_t tailGet() const noexcept override { return _tail.load (std::memory_order_relaxed); }
+
     //---------------------------//
     // clap_plugin_timer_support //
     //---------------------------//
@@ -290,51 +720,12 @@ protected:
     }
 
     bool paramsValue (clap_id paramId, double* value) noexcept override {
-        bool res = true;
-        switch (paramId) {
-            case Ports::Wet:
-                *value = _uiParams.wetLevel;
-                break;
-            case Ports::Dry:
-                *value = _uiParams.dryLevel;
-                break;
-            case Ports::RoomSize:
-                *value = _uiParams.roomSize;
-                break;
-            case Ports::Width:
-                *value = _uiParams.width;
-                break;
-            case Ports::Damping:
-                *value = _uiParams.damping;
-                break;
-
-            case Ports::Comb_1:
-            case Ports::Comb_2:
-            case Ports::Comb_3:
-            case Ports::Comb_4:
-            case Ports::Comb_5:
-            case Ports::Comb_6:
-            case Ports::Comb_7:
-            case Ports::Comb_8: {
-                auto index = static_cast<int> (paramId - Ports::Comb_1);
-                *value     = _verb.toggledCombFloat (index);
-                break;
-            }
-
-            case Ports::AllPass_1:
-            case Ports::AllPass_2:
-            case Ports::AllPass_3:
-            case Ports::AllPass_4: {
-                auto index = static_cast<int> (paramId - Ports::AllPass_1);
-                *value     = _verb.toggledAllPassFloat (index);
-                break;
-            }
+        if (paramId < Ports::paramsBegin() || paramId >= Ports::paramsEnd())
+            return false;
 
-            default:
-                res = false;
-                break;
-        }
-        return res;
+        refreshFromAudio();
+        *value = _uiValues[paramId - Ports::paramsBegin()];
+        return true;
     }
 
     bool paramsValueToText (clap_id paramId, double value, char* display, uint32_t size) noexcept override {
@@ -354,8 +745,10 @@ protected:
 
     void paramsFlush (const clap_input_events* in,
                       const clap_output_events* out) noexcept override {
-        (void) in;
-        (void) out;
+        bool paramChanged = collectFromMain (out);
+        foldModulation (in, in->size (in));
+        handleEvents (in, 0, in->size (in), UINT32_MAX, paramChanged);
+        publishParameters (paramChanged);
     }
 
 #if 0
@@ -371,7 +764,8 @@ protected:
     // clap_plugin_state //
     //-------------------//
     bool implementsState() const noexcept override { return true; }
-    static constexpr size_t stateNumElements() noexcept { return Ports::numParams() + 1; }
+    // Reduced Rate took the spare last element, which older states hold as 0
+    static constexpr size_t stateNumElements() noexcept { return Ports::numParams(); }
     static constexpr size_t stateDataSize() noexcept { return sizeof (double) * stateNumElements(); }
 
     bool stateSave (const clap_ostream* stream) noexcept override {
@@ -389,14 +783,11 @@ protected:
         auto data       = std::make_unique<double[]> (stateNumElements());
 
         if ((int64_t) dataSize == stream->read (stream, data.get(), dataSize)) {
-            {
-                std::lock_guard<std::mutex> sl (paramMutex);
-                for (auto ID = Ports::paramsBegin(); ID < Ports::paramsEnd(); ID++) {
-                    const auto index = clap_id (ID - Ports::paramsBegin());
-                    update (ID, data.get()[index]);
-                }
-                _uiParams = _rtParams;
+            for (auto ID = Ports::paramsBegin(); ID < Ports::paramsEnd(); ID++) {
+                const auto index = clap_id (ID - Ports::paramsBegin());
+                postFromMain (ID, data.get()[index]);
             }
+            requestFlush();
             _doUpdate.store (1);
         }
 
@@ -421,10 +812,8 @@ protected:
     bool guiCreate (const char* api, bool isFloating) noexcept override {
         if (_gui.create()) {
             _gui.setControlHandler ([this] (uint32_t ID, float value) {
-                std::lock_guard<std::mutex> sl (paramMutex);
-                update (ID, value);
-                _verb.setParameters (_rtParams);
-                _uiParams = _rtParams;
+                postFromMain (ID, value);
+                requestFlush();
             });
             return true;
         }
@@ -465,16 +854,36 @@ protected:
     bool guiSetTransient (const clap_window* window) noexcept override { return false; }
 
 private:
+    enum PortConfig : clap_id {
+        StereoToStereo = 0,
+        MonoToMono,
+        MonoToStereo,
+        numPortConfigs
+    };
+
     using HostProxy = clap::helpers::HostProxy<clap::helpers::MisbehaviourHandler::Terminate,
                                                clap::helpers::CheckingLevel::Maximal>;
     std::unique_ptr<HostProxy> _host;
-    Roboverb _verb;
     std::vector<clap_param_info_t> _paramInfo;
-    Roboverb::Parameters _uiParams, _rtParams;
     roboverb::GuiMain _gui;
+    clap_id _portConfig = StereoToStereo;
 
-    std::mutex paramMutex;
-    std::atomic<int> _doUpdate { 0 };
+    // audio thread only, or the main thread while inactive
+    Roboverb _verb;
+    alignas (cacheLineSize) Roboverb::Parameters _rtParams;
+    float _rtValues[Ports::numParams()] {};
+    uint32_t _rtTaken = 0;
+    float _modulation[Ports::Width - Ports::Wet + 1] {};
+
+    // main thread to audio thread, and back
+    alignas (cacheLineSize) ParamMailbox _fromMain;
+    alignas (cacheLineSize) ParamSnapshot _toMain;
+    alignas (cacheLineSize) std::atomic<int> _doUpdate { 0 };
+    std::atomic<uint32_t> _tail { 0 };
+
+    // main thread only
+    alignas (cacheLineSize) float _uiValues[Ports::numParams()] {};
+    uint32_t _uiVersion = 0;
 };
 
 } // namespace roboverb
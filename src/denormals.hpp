@@ -0,0 +1,98 @@
+/*
+    This file is part of Roboverb
+
+    Copyright (C) 2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#    define ROBOVERB_MXCSR 1
+#    include <xmmintrin.h>
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+#    define ROBOVERB_FPCR 1
+#elif defined(__arm__) && defined(__ARM_FP) && (defined(__GNUC__) || defined(__clang__))
+#    define ROBOVERB_FPSCR 1
+#endif
+
+namespace roboverb {
+
+/** Flushes denormal results, and on x86 denormal inputs, to zero for as
+    long as it's in scope, then restores the thread's previous mode.
+
+    A decaying tail leaves the comb and allpass recursions full of
+    denormals, which most CPUs handle in microcode at many times the cost of
+    a normal float.  Put one on the stack of every thread that renders
+    audio, it only touches the calling thread's floating point state. */
+class ScopedNoDenormals final {
+public:
+    ScopedNoDenormals() noexcept
+        : previous (read()) {
+        write (previous | mask);
+    }
+
+    ~ScopedNoDenormals() noexcept { write (previous); }
+
+    ScopedNoDenormals (const ScopedNoDenormals&)            = delete;
+    ScopedNoDenormals& operator= (const ScopedNoDenormals&) = delete;
+
+private:
+#if ROBOVERB_MXCSR
+    // flush to zero (bit 15) and denormals are zero (bit 6)
+    static constexpr uintptr_t mask = 0x8040;
+    static uintptr_t read() noexcept { return _mm_getcsr(); }
+    static void write (const uintptr_t mode) noexcept { _mm_setcsr ((unsigned int) mode); }
+#elif ROBOVERB_FPCR
+    // FZ (bit 24), which on AArch64 covers inputs as well as results
+    static constexpr uintptr_t mask = 1u << 24;
+    static uintptr_t read() noexcept {
+        uint64_t mode;
+        __asm__ __volatile__ ("mrs %0, fpcr"
+                              : "=r"(mode));
+        return (uintptr_t) mode;
+    }
+    static void write (const uintptr_t mode) noexcept {
+        __asm__ __volatile__ ("msr fpcr, %0"
+                              :
+                              : "r"((uint64_t) mode));
+    }
+#elif ROBOVERB_FPSCR
+    // FZ (bit 24) of the VFP status and control register
+    static constexpr uintptr_t mask = 1u << 24;
+    static uintptr_t read() noexcept {
+        uint32_t mode;
+        __asm__ __volatile__ ("vmrs %0, fpscr"
+                              : "=r"(mode));
+        return mode;
+    }
+    static void write (const uintptr_t mode) noexcept {
+        __asm__ __volatile__ ("vmsr fpscr, %0"
+                              :
+                              : "r"((uint32_t) mode));
+    }
+#else
+    // no known control register, processing runs in the default mode
+    static constexpr uintptr_t mask = 0;
+    static uintptr_t read() noexcept { return 0; }
+    static void write (uintptr_t) noexcept {}
+#endif
+
+    uintptr_t previous;
+};
+
+} // namespace roboverb
@@ -0,0 +1,159 @@
+/*
+    This file is part of Roboverb
+
+    Copyright (C) 2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "kernels.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    define ROBOVERB_X86 1
+#    if defined(_MSC_VER)
+#        include <intrin.h>
+#    else
+#        include <cpuid.h>
+#    endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#    define ROBOVERB_ARM 1
+#endif
+
+// one table per copy of kernels.cpp the build compiles, see src/meson.build
+namespace roboverb {
+namespace kernels {
+namespace scalar {
+extern const Kernels table;
+}
+#if ROBOVERB_X86
+namespace sse2 {
+extern const Kernels table;
+}
+namespace avx2 {
+extern const Kernels table;
+}
+namespace avx512 {
+extern const Kernels table;
+}
+#elif ROBOVERB_ARM
+namespace neon {
+extern const Kernels table;
+}
+#endif
+
+namespace {
+
+#if ROBOVERB_X86
+void cpuid (const unsigned leaf, unsigned (&regs)[4]) noexcept {
+#    if defined(_MSC_VER)
+    int info[4];
+    __cpuidex (info, (int) leaf, 0);
+    for (int i = 0; i < 4; ++i)
+        regs[i] = (unsigned) info[i];
+#    else
+    __cpuid_count (leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#    endif
+}
+
+/** Returns the register state the OS saves on a context switch. */
+uint64_t enabledStateMask() noexcept {
+#    if defined(_MSC_VER)
+    return _xgetbv (0);
+#    else
+    uint32_t lo, hi;
+    __asm__ volatile ("xgetbv"
+                      : "=a"(lo), "=d"(hi)
+                      : "c"(0));
+    return ((uint64_t) hi << 32) | lo;
+#    endif
+}
+
+struct Features {
+    bool avx2 = false, avx512 = false;
+
+    Features() noexcept {
+        unsigned regs[4];
+        cpuid (0, regs);
+        const unsigned maxLeaf = regs[0];
+        if (maxLeaf < 7)
+            return;
+
+        cpuid (1, regs);
+        const bool osxsave = (regs[2] & (1u << 27)) != 0;
+        const bool avx     = (regs[2] & (1u << 28)) != 0;
+        const bool fma     = (regs[2] & (1u << 12)) != 0;
+        const bool f16c    = (regs[2] & (1u << 29)) != 0; // half float delay lines
+        if (! (osxsave && avx && fma && f16c))
+            return;
+
+        // XMM and YMM state for AVX, plus opmask and ZMM state for AVX-512
+        const uint64_t state = enabledStateMask();
+        cpuid (7, regs);
+        avx2   = (state & 0x06) == 0x06 && (regs[1] & (1u << 5)) != 0;
+        avx512 = avx2 && (state & 0xe6) == 0xe6 && (regs[1] & (1u << 16)) != 0;
+    }
+};
+#endif
+
+struct Registry {
+    const Kernels* tables[4];
+    int count = 0;
+    const Kernels* selected;
+
+    Registry() noexcept {
+        tables[count++] = &scalar::table;
+#if ROBOVERB_X86
+        const Features features;
+        tables[count++] = &sse2::table;
+        if (features.avx2)
+            tables[count++] = &avx2::table;
+        if (features.avx512)
+            tables[count++] = &avx512::table;
+#elif ROBOVERB_ARM
+        tables[count++] = &neon::table;
+#endif
+
+        selected          = tables[count - 1];
+        const char* force = std::getenv ("ROBOVERB_KERNEL");
+        for (int i = 0; force != nullptr && i < count; ++i)
+            if (std::strcmp (force, tables[i]->name) == 0)
+                selected = tables[i];
+    }
+};
+
+const Registry& registry() noexcept {
+    static const Registry instance;
+    return instance;
+}
+
+} // namespace
+
+const Kernels& select() noexcept { return *registry().selected; }
+
+const Kernels& reference() noexcept { return scalar::table; }
+
+int available (const Kernels** dest, const int maxKernels) noexcept {
+    const Registry& r = registry();
+    int n             = 0;
+    for (; n < r.count && n < maxKernels; ++n)
+        dest[n] = r.tables[n];
+    return n;
+}
+
+} // namespace kernels
+} // namespace roboverb
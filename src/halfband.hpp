@@ -0,0 +1,295 @@
+/*
+    This file is part of Roboverb
+
+    Copyright (C) 2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+#include "simd.hpp"
+
+namespace roboverb {
+
+/** Allpass coefficients of the half-band filters, designed with the
+    elliptic method of Valenzuela and Constantinides.  Transition bands are
+    given as a fraction of the higher of the two rates. */
+struct SteepHalfBand {
+    // 0.0417 transition, ~75 dB: passes 20 kHz between 96 and 48 kHz
+    static constexpr int numCoefs           = 6;
+    static constexpr float coefs[numCoefs] = { 0.0666916297f, 0.235677025f, 0.441964767f,
+                                               0.634402038f, 0.795088604f, 0.932599892f };
+};
+
+struct WideHalfBand {
+    // 0.125 transition, ~77 dB: first stage of 192 to 48 kHz, where the
+    // band that folds back onto 0-24 kHz starts at 72 kHz
+    static constexpr int numCoefs           = 4;
+    static constexpr float coefs[numCoefs] = { 0.0688332252f, 0.25221956f, 0.505996958f, 0.813394667f };
+};
+
+/** Four lanes holding the two paths of a half-band filter for the left and
+    right channels, in that order. */
+#if ROBOVERB_SSE2 || ROBOVERB_NEON
+using Lanes = simd::f32x4;
+#else
+struct Lanes {
+    float v[4];
+
+    static Lanes loadUnaligned (const float* p) noexcept { return { { p[0], p[1], p[2], p[3] } }; }
+    void storeUnaligned (float* p) const noexcept {
+        for (int i = 0; i < 4; ++i)
+            p[i] = v[i];
+    }
+
+    friend Lanes operator+ (Lanes a, Lanes b) noexcept { return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+    friend Lanes operator- (Lanes a, Lanes b) noexcept { return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+    friend Lanes operator* (Lanes a, Lanes b) noexcept { return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+};
+#endif
+
+/** A two-path polyphase IIR half-band filter for a pair of channels, for
+    changing the rate by 2.  Each path is a chain of first-order allpasses
+    running at the lower rate, and the paths of both channels share one
+    vector, so a stage costs one vector multiply-add per pair of
+    coefficients per low-rate sample.  The phase is not linear, but the
+    group delay is only a few samples across the passband.  Use one instance
+    per direction. */
+template <typename Design>
+class HalfBand {
+public:
+    enum { numSections = Design::numCoefs / 2 };
+    static_assert (Design::numCoefs % 2 == 0, "both paths need the same number of allpasses");
+
+    void clear() noexcept {
+        for (int i = 0; i < numSections; ++i)
+            x[i] = y[i] = Lanes::loadUnaligned (zeros);
+    }
+
+    /** Reads 2 * numOutputs high-rate samples of each channel and writes
+        numOutputs low-rate samples.  The outputs may be the inputs. */
+    void down (const float* const inL, const float* const inR, const int numOutputs,
+               float* const outL, float* const outR) noexcept {
+        State state (*this);
+        for (int k = 0; k < numOutputs; ++k) {
+            const float in[4] = { inL[2 * k + 1], inL[2 * k], inR[2 * k + 1], inR[2 * k] };
+            float out[4];
+            state.run (Lanes::loadUnaligned (in)).storeUnaligned (out);
+            outL[k] = 0.5f * (out[0] + out[1]);
+            outR[k] = 0.5f * (out[2] + out[3]);
+        }
+        state.save (*this);
+    }
+
+    /** Reads numInputs low-rate samples of each channel and writes
+        2 * numInputs high-rate samples.  The outputs must not overlap the
+        inputs. */
+    void up (const float* const inL, const float* const inR, const int numInputs,
+             float* const outL, float* const outR) noexcept {
+        State state (*this);
+        for (int k = 0; k < numInputs; ++k) {
+            const float in[4] = { inL[k], inL[k], inR[k], inR[k] };
+            float out[4];
+            state.run (Lanes::loadUnaligned (in)).storeUnaligned (out);
+            outL[2 * k]     = out[0];
+            outL[2 * k + 1] = out[1];
+            outR[2 * k]     = out[2];
+            outR[2 * k + 1] = out[3];
+        }
+        state.save (*this);
+    }
+
+private:
+    static constexpr float zeros[4] = {};
+
+    /** The filter state copied out for a block, so it stays in registers
+        while the recursion runs instead of going through memory. */
+    struct State {
+        Lanes coefs[numSections], x[numSections], y[numSections];
+
+        explicit State (const HalfBand& filter) noexcept {
+            for (int i = 0; i < numSections; ++i) {
+                const float c[4] = { Design::coefs[2 * i], Design::coefs[2 * i + 1],
+                                     Design::coefs[2 * i], Design::coefs[2 * i + 1] };
+                coefs[i]         = Lanes::loadUnaligned (c);
+                x[i]             = filter.x[i];
+                y[i]             = filter.y[i];
+            }
+        }
+
+        void save (HalfBand& filter) const noexcept {
+            for (int i = 0; i < numSections; ++i) {
+                filter.x[i] = x[i];
+                filter.y[i] = y[i];
+            }
+        }
+
+        Lanes run (Lanes sample) noexcept {
+            run (sample, std::make_index_sequence<numSections>());
+            return sample;
+        }
+
+        // unrolled so the state stays in registers, and written so the only
+        // thing each output waits on from the last one is a multiply and a
+        // subtract
+        template <std::size_t... Index>
+        void run (Lanes& sample, std::index_sequence<Index...>) noexcept {
+            ((sample = section<Index> (sample)), ...);
+        }
+
+        template <std::size_t Index>
+        Lanes section (const Lanes sample) noexcept {
+            const Lanes out = (x[Index] + coefs[Index] * sample) - coefs[Index] * y[Index];
+            x[Index]        = sample;
+            y[Index]        = out;
+            return out;
+        }
+    };
+
+    Lanes x[numSections] {}, y[numSections] {};
+};
+
+/** Lowers the rate of a pair of channels by 1, 2 or 4, up to maxSamples
+    at a time.  Samples that don't make up a whole output yet wait for the
+    next call. */
+class Decimator {
+public:
+    enum { maxSamples = 256 };
+
+    /** Sets the factor and clears the filters. */
+    void setFactor (const int newFactor) noexcept {
+        factor = newFactor;
+        clear();
+    }
+
+    void clear() noexcept {
+        steep.clear();
+        wide.clear();
+        numPending = 0;
+    }
+
+    /** Filters numSamples of input into outL and outR and returns how many
+        samples it wrote to each. */
+    template <typename Sample>
+    int process (const Sample* const left, const Sample* const right, const int numSamples,
+                 float* const outL, float* const outR) noexcept {
+        float blockL[maxSamples + 4], blockR[maxSamples + 4];
+        for (int i = 0; i < numPending; ++i) {
+            blockL[i] = pending[0][i];
+            blockR[i] = pending[1][i];
+        }
+        for (int i = 0; i < numSamples; ++i) {
+            blockL[numPending + i] = static_cast<float> (left[i]);
+            blockR[numPending + i] = static_cast<float> (right[i]);
+        }
+
+        const int total      = numPending + numSamples;
+        const int numOutputs = total / factor;
+        numPending           = total - numOutputs * factor;
+        for (int i = 0; i < numPending; ++i) {
+            pending[0][i] = blockL[numOutputs * factor + i];
+            pending[1][i] = blockR[numOutputs * factor + i];
+        }
+
+        if (factor == 1) {
+            std::copy_n (blockL, numOutputs, outL);
+            std::copy_n (blockR, numOutputs, outR);
+        } else if (factor == 2) {
+            steep.down (blockL, blockR, numOutputs, outL, outR);
+        } else {
+            wide.down (blockL, blockR, 2 * numOutputs, blockL, blockR);
+            steep.down (blockL, blockR, numOutputs, outL, outR);
+        }
+
+        return numOutputs;
+    }
+
+private:
+    HalfBand<SteepHalfBand> steep;
+    HalfBand<WideHalfBand> wide;
+    float pending[2][4] {};
+    int factor = 1, numPending = 0;
+};
+
+/** Raises the rate of a pair of channels by 1, 2 or 4, the inverse of
+    Decimator.
+
+    Fed the outputs of a Decimator with the same factor, it always has
+    enough to write as many samples as the decimator was given.  That is
+    because it starts out holding factor - 1 samples of silence, which is
+    also the only latency it adds on top of the filters. */
+class Interpolator {
+public:
+    void setFactor (const int newFactor) noexcept {
+        factor = newFactor;
+        clear();
+    }
+
+    void clear() noexcept {
+        steep.clear();
+        wide.clear();
+        numHeld = factor - 1;
+        for (auto& channel : held)
+            for (auto& x : channel)
+                x = 0;
+    }
+
+    /** Filters numInputs low-rate samples of each channel and writes
+        numSamples high-rate samples to outL and outR; the rest are held for
+        the next call. */
+    void process (const float* const inL, const float* const inR, const int numInputs,
+                  float* const outL, float* const outR, const int numSamples) noexcept {
+        enum { size = Decimator::maxSamples + 4 };
+        float half[2][size], block[2][size];
+        const float* sourceL = inL;
+        const float* sourceR = inR;
+        if (factor == 2) {
+            steep.up (inL, inR, numInputs, block[0], block[1]);
+            sourceL = block[0];
+            sourceR = block[1];
+        } else if (factor == 4) {
+            steep.up (inL, inR, numInputs, half[0], half[1]);
+            wide.up (half[0], half[1], 2 * numInputs, block[0], block[1]);
+            sourceL = block[0];
+            sourceR = block[1];
+        }
+
+        const int total = numHeld + numInputs * factor;
+        for (int i = 0; i < total; ++i) {
+            const float l = i < numHeld ? held[0][i] : sourceL[i - numHeld];
+            const float r = i < numHeld ? held[1][i] : sourceR[i - numHeld];
+            if (i < numSamples) {
+                outL[i] = l;
+                outR[i] = r;
+            } else {
+                held[0][i - numSamples] = l;
+                held[1][i - numSamples] = r;
+            }
+        }
+        numHeld = total - numSamples;
+    }
+
+private:
+    HalfBand<SteepHalfBand> steep;
+    HalfBand<WideHalfBand> wide;
+    float held[2][4] {};
+    int factor = 1, numHeld = 0;
+};
+
+} // namespace roboverb
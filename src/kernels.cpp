@@ -0,0 +1,455 @@
+/*
+    This file is part of Roboverb
+
+    Copyright (C) 2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*  Compiled once per instruction set with ROBOVERB_KERNEL_ISA set to the
+    kernel's name (and ROBOVERB_SCALAR for the reference).  Only simd.hpp
+    may be included here: it moves into a namespace named after the kernel,
+    so no inline function compiled with wider instructions can be merged
+    with the copy the rest of the plugin calls.
+*/
+
+#ifndef ROBOVERB_KERNEL_ISA
+#    error "ROBOVERB_KERNEL_ISA must name the kernel being compiled"
+#endif
+
+#include "kernels.hpp"
+#include "simd.hpp"
+
+#define ROBOVERB_STRINGIFY2(x) #x
+#define ROBOVERB_STRINGIFY(x) ROBOVERB_STRINGIFY2 (x)
+
+namespace roboverb {
+namespace kernels {
+namespace ROBOVERB_KERNEL_ISA {
+namespace {
+
+using Vec = roboverb::simd::native;
+using roboverb::simd::mulAdd;
+
+/** Frames of half float delay line converted to float at a time. */
+enum { halfChunk = 64 };
+
+/** Runs the lanes' first-order recursions y[i] = a[i] * y[i - 1] + b[i]
+    across the vector by recursive doubling: after the step that looks
+    Shift lanes back, every lane holds its recursion over the last 2 * Shift
+    lanes, and `a` the product of their coefficients.  The recursion into
+    the first lane is left for the caller to add as a * y[-1]. */
+template <class V, int Shift, bool Done = (Shift >= V::width)>
+struct Scan {
+    static void run (V& a, V& b) noexcept {
+        const V one = V::broadcast (1.0f);
+        b           = mulAdd (a, V::template shiftUp<Shift> (b), b);
+        a           = a * (V::template shiftUp<Shift> (a) + (one - V::template shiftUp<Shift> (one)));
+        Scan<V, Shift * 2>::run (a, b);
+    }
+};
+
+template <class V, int Shift>
+struct Scan<V, Shift, true> {
+    static void run (V&, V&) noexcept {}
+};
+
+/** Runs frames [i, end) through a delay line that does not wrap before
+    `end`.
+
+    Every frame of the run is read before any is written, and a comb is
+    always longer than the run, so the reads and writes are whole vectors
+    along time.  What's left of the recursion is the damping lowpass, which
+    is evaluated a vector at a time with Scan and carried from vector to
+    vector in one lane; the feedback write and the output are plain vector
+    arithmetic.  A single comb gets the full vector width this way, which
+    spreading combs across lanes can't give it. */
+template <bool Ramped>
+inline void combLineRun (float* const buf, int& idx, float& last,
+                         const float* const input, const float* const damp, const float* const feedback,
+                         float* const out, int i, const int end) noexcept {
+    if (end - i >= Vec::width) {
+        const Vec one = Vec::broadcast (1.0f);
+        Vec carry     = Vec::broadcast (last);
+        for (; i + Vec::width <= end; i += Vec::width, idx += Vec::width) {
+            const Vec d  = Ramped ? Vec::loadUnaligned (damp + i) : Vec::broadcast (*damp);
+            const Vec fb = Ramped ? Vec::loadUnaligned (feedback + i) : Vec::broadcast (*feedback);
+            const Vec o  = Vec::loadUnaligned (buf + idx);
+
+            Vec a = d, b = o * (one - d);
+            Scan<Vec, 1>::run (a, b);
+            const Vec y = mulAdd (a, carry, b);
+            carry       = Vec::splatLast (y);
+
+            mulAdd (y, fb, Vec::loadUnaligned (input + i)).storeUnaligned (buf + idx);
+            (Vec::loadUnaligned (out + i) + o).storeUnaligned (out + i);
+        }
+        last = Vec::lastLane (carry);
+    }
+
+    for (; i < end; ++i, ++idx) {
+        const float d  = damp[Ramped ? i : 0];
+        const float d1 = 1.0f - d;
+        const float fb = feedback[Ramped ? i : 0];
+        const float o  = buf[idx];
+        last           = mulAdd (last, d, o * d1);
+        buf[idx]       = mulAdd (last, fb, input[i]);
+        out[i] += o;
+    }
+}
+
+/** Runs a block through one delay line in runs up to its wrap point, so
+    there is no per-sample modulo. */
+template <bool Ramped>
+inline void combLineBlock (float* const buf, const int size, int& idx, float& last,
+                           const float* const input, const float* const damp, const float* const feedback,
+                           float* const out, const int numSamples) noexcept {
+    for (int i = 0; i < numSamples;) {
+        const int end = i + (numSamples - i < size - idx ? numSamples - i : size - idx);
+        combLineRun<Ramped> (buf, idx, last, input, damp, feedback, out, i, end);
+        i = end;
+
+        if (idx == size)
+            idx = 0;
+    }
+}
+
+/** Both lines of a comb, one after the other.  Each line's runs depend
+    only on its own length, so a line renders the same whichever line it
+    is paired with. */
+template <bool Ramped>
+void comb (float* const* const buffers, const int* const sizes, int* const indices, float* const last,
+           const float* const input, const float* const damp, const float* const feedback,
+           float* const outL, float* const outR, const int numSamples) noexcept {
+    combLineBlock<Ramped> (buffers[0], sizes[0], indices[0], last[0], input, damp, feedback, outL, numSamples);
+    combLineBlock<Ramped> (buffers[1], sizes[1], indices[1], last[1], input, damp, feedback, outR, numSamples);
+}
+
+/** One delay line of comb(), for an odd comb out when the channels are
+    rendered separately.  Only the first entry of each state array is used
+    and nothing is written to outR. */
+template <bool Ramped>
+void combLine (float* const* const buffers, const int* const sizes, int* const indices, float* const last,
+               const float* const input, const float* const damp, const float* const feedback,
+               float* const outL, float* const, const int numSamples) noexcept {
+    combLineBlock<Ramped> (buffers[0], sizes[0], indices[0], last[0], input, damp, feedback, outL, numSamples);
+}
+
+/** Runs samples [i, end) through a delay line that does not wrap before
+    `end`. */
+inline void allPassRun (float* const buffer, int& index, float* const samples, int i, const int end) noexcept {
+    for (; i < end; ++i, ++index) {
+        const float in            = samples[i];
+        const float bufferedValue = buffer[index];
+        buffer[index]             = in + (bufferedValue * 0.5f);
+        samples[i]                = bufferedValue - in;
+    }
+}
+
+void allPass (float* const buffer, const int size, int* const bufferIndex,
+              float* const samples, const int numSamples) noexcept {
+    int index = *bufferIndex;
+
+    for (int i = 0; i < numSamples;) {
+        const int end = i + (numSamples - i < size - index ? numSamples - i : size - index);
+        allPassRun (buffer, index, samples, i, end);
+        i = end;
+
+        if (index == size)
+            index = 0;
+    }
+
+    *bufferIndex = index;
+}
+
+//==============================================================================
+/*  The half float kernels copy each run of a delay line into a float line
+    of up to halfChunk frames, a vector at a time, run the float kernels'
+    loops over it and convert it back.  A run never touches a frame of the
+    line twice, so this rounds exactly where converting every sample on its
+    own would, without a conversion on the path of every sample.
+*/
+/** One delay line of combHalf(). */
+template <bool Ramped>
+inline void combLineHalfBlock (Half* const buf, const int size, int& idx, float& last,
+                               const float* const input, const float* const damp, const float* const feedback,
+                               float* const out, const int numSamples) noexcept {
+    float line[halfChunk];
+
+    for (int i = 0; i < numSamples;) {
+        int n = size - idx;
+        n     = numSamples - i < n ? numSamples - i : n;
+        n     = n < (int) halfChunk ? n : (int) halfChunk;
+
+        simd::fromHalf (buf + idx, line, n);
+        int pos = 0;
+        combLineRun<Ramped> (line, pos, last, input, damp, feedback, out, i, i + n);
+        simd::toHalf (line, buf + idx, n);
+        i += n;
+
+        if ((idx += n) == size)
+            idx = 0;
+    }
+}
+
+template <bool Ramped>
+void combHalf (Half* const* const buffers, const int* const sizes, int* const indices, float* const last,
+               const float* const input, const float* const damp, const float* const feedback,
+               float* const outL, float* const outR, const int numSamples) noexcept {
+    combLineHalfBlock<Ramped> (buffers[0], sizes[0], indices[0], last[0], input, damp, feedback, outL, numSamples);
+    combLineHalfBlock<Ramped> (buffers[1], sizes[1], indices[1], last[1], input, damp, feedback, outR, numSamples);
+}
+
+template <bool Ramped>
+void combLineHalf (Half* const* const buffers, const int* const sizes, int* const indices, float* const last,
+                   const float* const input, const float* const damp, const float* const feedback,
+                   float* const outL, float* const, const int numSamples) noexcept {
+    combLineHalfBlock<Ramped> (buffers[0], sizes[0], indices[0], last[0], input, damp, feedback, outL, numSamples);
+}
+
+void allPassHalf (Half* const buffer, const int size, int* const bufferIndex,
+                  float* const samples, const int numSamples) noexcept {
+    int index = *bufferIndex;
+    float line[halfChunk];
+
+    for (int i = 0; i < numSamples;) {
+        int n = size - index;
+        n     = numSamples - i < n ? numSamples - i : n;
+        n     = n < (int) halfChunk ? n : (int) halfChunk;
+
+        simd::fromHalf (buffer + index, line, n);
+        int pos = 0;
+        allPassRun (line, pos, samples, i, i + n);
+        simd::toHalf (line, buffer + index, n);
+        i += n;
+
+        if ((index += n) == size)
+            index = 0;
+    }
+
+    *bufferIndex = index;
+}
+
+void input (const float* const left, const float* const right, const float gain,
+            float* const dest, const int numSamples) noexcept {
+    const Vec g = Vec::broadcast (gain);
+
+    int i = 0;
+    for (; i + Vec::width <= numSamples; i += Vec::width)
+        ((Vec::loadUnaligned (left + i) + Vec::loadUnaligned (right + i)) * g).store (dest + i);
+
+    for (; i < numSamples; ++i)
+        dest[i] = (left[i] + right[i]) * gain;
+}
+
+/** Each vector of input is loaded before the matching output is stored, so
+    processing in place is safe. */
+template <bool Ramped>
+void mix (const float* const wetL, const float* const wetR,
+          const float* const left, const float* const right,
+          float* const out1, float* const out2,
+          const float* const dry, const float* const wet1, const float* const wet2,
+          const int numSamples) noexcept {
+    int i = 0;
+    for (; i + Vec::width <= numSamples; i += Vec::width) {
+        const Vec g   = Ramped ? Vec::load (dry + i) : Vec::broadcast (*dry);
+        const Vec w1  = Ramped ? Vec::load (wet1 + i) : Vec::broadcast (*wet1);
+        const Vec w2  = Ramped ? Vec::load (wet2 + i) : Vec::broadcast (*wet2);
+        const Vec l   = Vec::load (wetL + i);
+        const Vec r   = Vec::load (wetR + i);
+        const Vec inL = Vec::loadUnaligned (left + i);
+        const Vec inR = Vec::loadUnaligned (right + i);
+        (l * w1 + r * w2 + inL * g).storeUnaligned (out1 + i);
+        (r * w1 + l * w2 + inR * g).storeUnaligned (out2 + i);
+    }
+
+    for (; i < numSamples; ++i) {
+        const float g  = dry[Ramped ? i : 0];
+        const float w1 = wet1[Ramped ? i : 0];
+        const float w2 = wet2[Ramped ? i : 0];
+        const float l = wetL[i], r = wetR[i];
+        out1[i]        = l * w1 + r * w2 + left[i] * g;
+        out2[i]        = r * w1 + l * w2 + right[i] * g;
+    }
+}
+
+template <bool Ramped>
+void mixMono (const float* const wet, const float* const input, float* const out,
+              const float* const dry, const float* const wet1, const int numSamples) noexcept {
+    int i = 0;
+    for (; i + Vec::width <= numSamples; i += Vec::width) {
+        const Vec g  = Ramped ? Vec::load (dry + i) : Vec::broadcast (*dry);
+        const Vec w1 = Ramped ? Vec::load (wet1 + i) : Vec::broadcast (*wet1);
+        (Vec::load (wet + i) * w1 + Vec::loadUnaligned (input + i) * g).storeUnaligned (out + i);
+    }
+
+    for (; i < numSamples; ++i)
+        out[i] = wet[i] * wet1[Ramped ? i : 0] + input[i] * dry[Ramped ? i : 0];
+}
+
+//==============================================================================
+// RoboverbBank kernels: one instance per lane, lane-interleaved blocks.
+
+/** Both channels of one comb, walked together in runs up to the nearer
+    wrap point. */
+template <bool Ramped, bool Masked>
+void bankComb (float* const* const buffers, const int* const sizes, int* const indices, float* const last,
+               const float* const maskData, const float* const input, const float* const damp,
+               const float* const feedback, float* const wetL, float* const wetR, const int numSamples) noexcept {
+    enum { lanes = Vec::width };
+    float* const bufL = buffers[0];
+    float* const bufR = buffers[1];
+    const int sizeL = sizes[0], sizeR = sizes[1];
+    int idxL = indices[0], idxR = indices[1];
+
+    const Vec mask = Masked ? Vec::load (maskData) : Vec::broadcast (0.0f);
+    const Vec zero = Vec::broadcast (0.0f);
+    const Vec one  = Vec::broadcast (1.0f);
+    Vec d          = Vec::load (damp);
+    Vec d1         = one - d;
+    Vec fb         = Vec::load (feedback);
+    Vec lastL      = Vec::load (last);
+    Vec lastR      = Vec::load (last + lanes);
+
+    for (int i = 0; i < numSamples;) {
+        int run = numSamples - i;
+        run     = run < sizeL - idxL ? run : sizeL - idxL;
+        run     = run < sizeR - idxR ? run : sizeR - idxR;
+        const int end = i + run;
+        for (; i < end; ++i, ++idxL, ++idxR) {
+            if (Ramped) {
+                d  = Vec::load (damp + i * lanes);
+                d1 = one - d;
+                fb = Vec::load (feedback + i * lanes);
+            }
+
+            const Vec in    = Vec::load (input + i * lanes);
+            const Vec oL    = Vec::load (bufL + idxL * lanes);
+            const Vec oR    = Vec::load (bufR + idxR * lanes);
+            const Vec nextL = (oL * d1) + (lastL * d);
+            const Vec nextR = (oR * d1) + (lastR * d);
+            const Vec inL   = in + (nextL * fb);
+            const Vec inR   = in + (nextR * fb);
+            const Vec accL  = Vec::load (wetL + i * lanes);
+            const Vec accR  = Vec::load (wetR + i * lanes);
+
+            if (Masked) {
+                Vec::select (mask, inL, oL).store (bufL + idxL * lanes);
+                Vec::select (mask, inR, oR).store (bufR + idxR * lanes);
+                lastL = Vec::select (mask, nextL, lastL);
+                lastR = Vec::select (mask, nextR, lastR);
+                (accL + Vec::select (mask, oL, zero)).store (wetL + i * lanes);
+                (accR + Vec::select (mask, oR, zero)).store (wetR + i * lanes);
+            } else {
+                inL.store (bufL + idxL * lanes);
+                inR.store (bufR + idxR * lanes);
+                lastL = nextL;
+                lastR = nextR;
+                (accL + oL).store (wetL + i * lanes);
+                (accR + oR).store (wetR + i * lanes);
+            }
+        }
+
+        if (idxL == sizeL)
+            idxL = 0;
+        if (idxR == sizeR)
+            idxR = 0;
+    }
+
+    indices[0] = idxL;
+    indices[1] = idxR;
+    lastL.store (last);
+    lastR.store (last + lanes);
+}
+
+template <bool Masked>
+void bankAllPass (float* const buffer, const int size, int* const index, const float* const maskData,
+                  float* const samples, const int numSamples) noexcept {
+    enum { lanes = Vec::width };
+    const Vec mask = Masked ? Vec::load (maskData) : Vec::broadcast (0.0f);
+    const Vec half = Vec::broadcast (0.5f);
+    int idx        = *index;
+
+    for (int i = 0; i < numSamples;) {
+        const int end = i + (numSamples - i < size - idx ? numSamples - i : size - idx);
+        for (; i < end; ++i, ++idx) {
+            const Vec x        = Vec::load (samples + i * lanes);
+            const Vec buffered = Vec::load (buffer + idx * lanes);
+            const Vec next     = x + (buffered * half);
+            const Vec y        = buffered - x;
+            (Masked ? Vec::select (mask, next, buffered) : next).store (buffer + idx * lanes);
+            (Masked ? Vec::select (mask, y, x) : y).store (samples + i * lanes);
+        }
+
+        if (idx == size)
+            idx = 0;
+    }
+
+    *index = idx;
+}
+
+template <bool Ramped>
+void bankMix (float* const wetL, float* const wetR, const float* const left, const float* const right,
+              const float* const dry, const float* const wet1, const float* const wet2, const int numSamples) noexcept {
+    enum { lanes = Vec::width };
+    Vec g  = Vec::load (dry);
+    Vec w1 = Vec::load (wet1);
+    Vec w2 = Vec::load (wet2);
+
+    for (int i = 0; i < numSamples * lanes; i += lanes) {
+        if (Ramped) {
+            g  = Vec::load (dry + i);
+            w1 = Vec::load (wet1 + i);
+            w2 = Vec::load (wet2 + i);
+        }
+
+        const Vec l = Vec::load (wetL + i);
+        const Vec r = Vec::load (wetR + i);
+        (l * w1 + r * w2 + Vec::load (left + i) * g).store (wetL + i);
+        (r * w1 + l * w2 + Vec::load (right + i) * g).store (wetR + i);
+    }
+}
+
+static_assert (Vec::width <= maxBankLanes, "maxBankLanes is narrower than the widest vector");
+
+} // namespace
+
+extern const Kernels table;
+const Kernels table = {
+    ROBOVERB_STRINGIFY (ROBOVERB_KERNEL_ISA),
+    &comb<false>,
+    &comb<true>,
+    &combLine<false>,
+    &combLine<true>,
+    &allPass,
+    &input,
+    &mix<false>,
+    &mix<true>,
+    &mixMono<false>,
+    &mixMono<true>,
+    { &combHalf<false>, &combHalf<true>, &combLineHalf<false>, &combLineHalf<true>, &allPassHalf },
+    { Vec::width,
+      &bankComb<false, false>,
+      &bankComb<true, false>,
+      &bankComb<false, true>,
+      &bankComb<true, true>,
+      &bankAllPass<false>,
+      &bankAllPass<true>,
+      &bankMix<false>,
+      &bankMix<true> }
+};
+
+} // namespace ROBOVERB_KERNEL_ISA
+} // namespace kernels
+} // namespace roboverb
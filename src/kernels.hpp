@@ -0,0 +1,147 @@
+/*
+    This file is part of Roboverb
+
+    Copyright (C) 2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace roboverb {
+namespace kernels {
+
+/** A delay line sample stored as an IEEE half float, see
+    Roboverb::setCompactStorage(). */
+using Half = uint16_t;
+
+/** Runs a block through both channels of one comb, adding the outputs to
+    outL and outR.  The four state arrays hold the left then right entry.
+    The plain variant reads damp[0] and feedback[0] for the whole block,
+    the ramped one a value per sample.  The two entries may also be two
+    combs of one channel with outL and outR the same buffer; the first
+    entry's output is added first.  `Storage` is the delay line's sample
+    type, the comb's own state is always float. */
+template <typename Storage>
+using CombKernelFor = void (*) (Storage* const* buffers, const int* sizes, int* indices, float* last,
+                                const float* input, const float* damp, const float* feedback,
+                                float* outL, float* outR, int numSamples);
+
+/** Runs a block through one allpass filter in place. */
+template <typename Storage>
+using AllPassKernelFor = void (*) (Storage* buffer, int size, int* index, float* samples, int numSamples);
+
+using CombKernel    = CombKernelFor<float>;
+using AllPassKernel = AllPassKernelFor<float>;
+
+/** Writes (left + right) * gain to input. */
+using InputKernel = void (*) (const float* left, const float* right, float gain, float* input, int numSamples);
+
+/** Mixes the wet blocks with the dry input.  The plain variant reads one
+    value from each gain pointer, the ramped one a value per sample.  out1
+    and out2 may be the same buffers as left and right. */
+using MixKernel = void (*) (const float* wetL, const float* wetR,
+                            const float* left, const float* right,
+                            float* out1, float* out2,
+                            const float* dry, const float* wet1, const float* wet2,
+                            int numSamples);
+
+/** Mixes one wet block with the dry input of a mono reverb, with the gain
+    pointers read as for MixKernel.  out may be the same buffer as input. */
+using MonoMixKernel = void (*) (const float* wet, const float* input, float* out,
+                                const float* dry, const float* wet1, int numSamples);
+
+/** Runs a block through both channels of one comb of a RoboverbBank group.
+
+    Buffers and blocks are lane-interleaved: frame i of lane l is at
+    [i * lanes + l], and last holds the left then the right lane values.
+    The plain variant reads one damp and feedback value per lane for the
+    whole block, the ramped one a frame of them per sample.  The masked
+    variants leave the delay lines, last and outputs of lanes whose mask
+    is off as they were. */
+using BankCombKernel = void (*) (float* const* buffers, const int* sizes, int* indices, float* last,
+                                 const float* mask, const float* input, const float* damp, const float* feedback,
+                                 float* wetL, float* wetR, int numSamples);
+
+/** Runs a lane-interleaved block through one allpass filter in place. */
+using BankAllPassKernel = void (*) (float* buffer, int size, int* index, const float* mask,
+                                    float* samples, int numSamples);
+
+/** Mixes lane-interleaved wet blocks with the dry input in place, with the
+    gain pointers read a lane at a time as for BankCombKernel. */
+using BankMixKernel = void (*) (float* wetL, float* wetR, const float* left, const float* right,
+                                const float* dry, const float* wet1, const float* wet2, int numSamples);
+
+/** The most lanes any instruction set gives a RoboverbBank group. */
+enum { maxBankLanes = 16 };
+
+/** The kernels of a RoboverbBank group, which runs one instance per vector
+    lane.  They compute what the sample-major Roboverb filters do. */
+struct BankKernels {
+    int lanes;
+    BankCombKernel comb, combRamped, combMasked, combRampedMasked;
+    BankAllPassKernel allPass, allPassMasked;
+    BankMixKernel mix, mixRamped;
+};
+
+/** The delay line kernels for half float storage.  They convert the lines
+    to float and back around the float kernels' arithmetic, so they round
+    each stored sample once and otherwise compute what the float kernels
+    do. */
+struct HalfKernels {
+    CombKernelFor<Half> comb, combRamped;
+    CombKernelFor<Half> combLine, combLineRamped;
+    AllPassKernelFor<Half> allPass;
+};
+
+/** The inner loops of block processing for one instruction set.
+
+    kernels.cpp is compiled once per instruction set the target
+    architecture has (scalar, SSE2, AVX2 and AVX-512 on x86, scalar and NEON
+    on ARM), each copy in its own namespace.  The scalar kernels are the
+    reference the others are checked against.
+
+    Hosts process in place, so every kernel has to give the same result
+    when its output buffers are its input buffers; roboverb-bench --verify
+    checks that too.
+*/
+struct Kernels {
+    const char* name;
+    CombKernel comb, combRamped;
+    CombKernel combLine, combLineRamped; /**< only the first entry */
+    AllPassKernel allPass;
+    InputKernel input;
+    MixKernel mix, mixRamped;
+    MonoMixKernel mixMono, mixMonoRamped;
+    HalfKernels half;
+    BankKernels bank;
+};
+
+/** Returns the kernels for the widest instruction set this CPU supports.
+    The ROBOVERB_KERNEL environment variable can name a kernel to use
+    instead, e.g. ROBOVERB_KERNEL=sse2; names the CPU cannot run are
+    ignored.  The choice is made on the first call. */
+const Kernels& select() noexcept;
+
+/** Returns the scalar reference kernels. */
+const Kernels& reference() noexcept;
+
+/** Fills `dest` with every kernel set this CPU can run, reference first,
+    and returns how many there are. */
+int available (const Kernels** dest, int maxKernels) noexcept;
+
+} // namespace kernels
+} // namespace roboverb
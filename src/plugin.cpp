@@ -17,25 +17,41 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <limits>
+
 #include <lvtk/plugin.hpp>
 
+#include "denormals.hpp"
 #include "ports.hpp"
 #include "roboverb.hpp"
 
 #define ROBOVERB_URI "https://kushview.net/plugins/roboverb"
+#define ROBOVERB_2_URI "https://kushview.net/plugins/roboverb#2"
+#define ROBOVERB_MONO_URI "https://kushview.net/plugins/roboverb#mono"
 
 using roboverb::Ports;
 
-class Module final : public lvtk::Plugin<Module> {
+/** The stereo plugin, or with the Mono layout a mono in, mono out plugin
+    that only runs the left delay network. */
+template <Roboverb::Layout Layout>
+class Module final : public lvtk::Plugin<Module<Layout>> {
 public:
     Module (const lvtk::Args& args)
-        : Plugin (args),
+        : lvtk::Plugin<Module<Layout>> (args),
+          verb (Layout),
           sampleRate (args.sample_rate),
-          bundlePath (args.bundle) {}
+          bundlePath (args.bundle) {
+        for (auto& value : values)
+            value = std::numeric_limits<float>::quiet_NaN();
+    }
 
     ~Module() {}
 
     void connect_port (uint32_t port, void* data) {
+        if (Layout == Roboverb::Mono)
+            port = Ports::fromMono (port);
+
         switch (port) {
             case Ports::AudioIn_1:
                 input[0] = (float*) data;
@@ -51,51 +67,13 @@ public:
                 break;
         }
 
-        // Lilv will connect NULL on instantiate... just return
-        if (data == nullptr)
-            return;
-
-        switch (port) {
-            case Ports::Wet:
-                params.wetLevel = *((float*) data);
-                break;
-            case Ports::Dry:
-                params.dryLevel = *((float*) data);
-                break;
-            case Ports::RoomSize:
-                params.roomSize = *((float*) data);
-                break;
-            case Ports::Width:
-                params.width = *((float*) data);
-                break;
-            case Ports::Damping:
-                params.damping = *((float*) data);
-                break;
-
-            case Ports::Comb_1:
-            case Ports::Comb_2:
-            case Ports::Comb_3:
-            case Ports::Comb_4:
-            case Ports::Comb_5:
-            case Ports::Comb_6:
-            case Ports::Comb_7:
-            case Ports::Comb_8: {
-                const auto value = *((float*) data);
-                verb.setCombToggle (port - Ports::Comb_1, value > 0.f);
-            } break;
-
-            case Ports::AllPass_1:
-            case Ports::AllPass_2:
-            case Ports::AllPass_3:
-            case Ports::AllPass_4: {
-                const auto value = *((float*) data);
-                verb.setAllPassToggle (port - Ports::AllPass_1, value > 0.f);
-            } break;
-        }
+        if (port >= Ports::paramsBegin() && port < Ports::paramsEnd())
+            controls[port - Ports::paramsBegin()] = (const float*) data;
     }
 
     void activate() {
-        verb.reset();
+        // re-slices the preallocated delay lines and clears them, without
+        // allocating
         verb.setSampleRate (sampleRate);
     }
 
@@ -104,21 +82,76 @@ public:
     }
 
     void run (uint32_t _nframes) {
-        const auto nframes = static_cast<int> (_nframes);
+        const roboverb::ScopedNoDenormals noDenormals;
 
-        if (params != verb.getParameters())
-            verb.setParameters (params);
+        const auto nframes = static_cast<int> (_nframes);
 
-        verb.processStereo (input[0], input[1], output[0], output[1], nframes);
+        updateParameters();
+        if (Layout == Roboverb::Mono) {
+            if (output[0] != input[0])
+                std::copy_n (input[0], nframes, output[0]);
+            verb.processMono (output[0], nframes);
+        } else {
+            verb.processStereo (input[0], input[1], output[0], output[1], nframes);
+        }
     }
 
 private:
+    static constexpr uint32_t bit (const uint32_t port) noexcept {
+        return 1u << (port - Ports::paramsBegin());
+    }
+
+    float control (const uint32_t port) const noexcept {
+        return values[port - Ports::paramsBegin()];
+    }
+
+    /** Reads every connected control port and applies only what changed
+        since the last cycle.  Hosts may write new values into a buffer they
+        connected once, so the ports are read on every run(). */
+    void updateParameters() noexcept {
+        uint32_t dirty = 0;
+        for (uint32_t i = 0; i < Ports::numParams(); ++i) {
+            if (controls[i] == nullptr || *controls[i] == values[i])
+                continue;
+            values[i] = *controls[i];
+            dirty |= 1u << i;
+        }
+
+        if (dirty == 0)
+            return;
+
+        if (dirty & (bit (Ports::Wet) | bit (Ports::Dry) | bit (Ports::Width)))
+            verb.setLevels (control (Ports::Wet), control (Ports::Dry), control (Ports::Width));
+        if (dirty & (bit (Ports::RoomSize) | bit (Ports::Damping)))
+            verb.setRoom (control (Ports::RoomSize), control (Ports::Damping));
+
+        for (uint32_t port = Ports::Comb_1; port <= Ports::Comb_8; ++port)
+            if (dirty & bit (port))
+                verb.setCombToggle ((int) (port - Ports::Comb_1), control (port) > 0.f);
+        for (uint32_t port = Ports::AllPass_1; port <= Ports::AllPass_4; ++port)
+            if (dirty & bit (port))
+                verb.setAllPassToggle ((int) (port - Ports::AllPass_1), control (port) > 0.f);
+
+        // re-slices and clears the delay lines, without allocating; the
+        // port is marked expensive and not automatic for that reason
+        if (dirty & bit (Ports::ReducedRate))
+            verb.setReducedInternalRate (control (Ports::ReducedRate) > 0.f);
+    }
+
     Roboverb verb;
-    Roboverb::Parameters params;
     double sampleRate;
     std::string bundlePath;
-    float* input[2];
-    float* output[2];
+    float* input[2] {};
+    float* output[2] {};
+
+    // connected control ports and the values last applied from them; NaN
+    // never compares equal, so the first run() applies every port
+    const float* controls[Ports::numParams()] {};
+    float values[Ports::numParams()];
 };
 
-static const lvtk::Descriptor<Module> sDescriptor (ROBOVERB_URI);
+// the original stereo URI keeps its 21 port layout, so saved sessions still
+// load; it never connects the reduced rate port and runs at the full rate
+static const lvtk::Descriptor<Module<Roboverb::Stereo>> sDescriptor (ROBOVERB_URI);
+static const lvtk::Descriptor<Module<Roboverb::Stereo>> s2Descriptor (ROBOVERB_2_URI);
+static const lvtk::Descriptor<Module<Roboverb::Mono>> sMonoDescriptor (ROBOVERB_MONO_URI);
@@ -47,11 +47,19 @@ struct Ports {
         AllPass_2 = 18,
         AllPass_3 = 19,
         AllPass_4 = 20,
+
+        ReducedRate = 21,
     };
 
     inline static constexpr uint32_t paramsBegin() { return Wet; }
-    inline static constexpr uint32_t paramsEnd() { return 1 + AllPass_4; }
+    inline static constexpr uint32_t paramsEnd() { return 1 + ReducedRate; }
     inline static constexpr uint32_t numParams() { return paramsEnd() - paramsBegin(); }
+
+    /** Maps a port of the mono LV2 plugin, which has one audio input and
+        one output followed by the same controls, to the stereo index. */
+    inline static constexpr uint32_t fromMono (uint32_t port) {
+        return port == 0 ? AudioIn_1 : port == 1 ? AudioOut_1 : port + 2;
+    }
 };
 
 } // namespace roboverb
@@ -0,0 +1,650 @@
+/*
+    This file is part of Roboverb
+
+    Copyright (C) 2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*  roboverb-render: applies Roboverb to WAV files outside a plugin host.
+
+    Every input is memory-mapped, converted to float a block at a time,
+    run through a RoboverbBank and written straight into a memory-mapped
+    output file.  Files are handed to a pool of worker threads in batches
+    of up to one bank group's worth, and each batch is rendered in
+    lockstep, one bank instance per file.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#    define WIN32_LEAN_AND_MEAN
+#    define NOMINMAX
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include "bank.hpp"
+#include "denormals.hpp"
+
+namespace {
+
+/** Frames converted and processed per pass. */
+constexpr int renderBlockSize = 8192;
+
+//==============================================================================
+/** A whole file mapped into memory, read-only or created read-write at a
+    fixed size. */
+class MappedFile {
+public:
+    MappedFile (const std::string& path) { open (path, 0); }
+    MappedFile (const std::string& path, const size_t newSize) { open (path, newSize); }
+    ~MappedFile() { close(); }
+
+    MappedFile (const MappedFile&)            = delete;
+    MappedFile& operator= (const MappedFile&) = delete;
+
+    uint8_t* data() const noexcept { return bytes; }
+    size_t size() const noexcept { return length; }
+
+private:
+    uint8_t* bytes = nullptr;
+    size_t length  = 0;
+
+#if defined(_WIN32)
+    HANDLE file    = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+
+    void open (const std::string& path, const size_t newSize) {
+        const bool writing = newSize > 0;
+        file               = CreateFileA (path.c_str(),
+                            writing ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                            writing ? 0 : FILE_SHARE_READ,
+                            nullptr,
+                            writing ? CREATE_ALWAYS : OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error ("cannot open " + path);
+
+        LARGE_INTEGER fileSize;
+        fileSize.QuadPart = (LONGLONG) newSize;
+        if (! writing && ! GetFileSizeEx (file, &fileSize))
+            throw std::runtime_error ("cannot stat " + path);
+        length = (size_t) fileSize.QuadPart;
+        if (length == 0)
+            return;
+
+        mapping = CreateFileMappingA (file, nullptr, writing ? PAGE_READWRITE : PAGE_READONLY,
+                                      fileSize.HighPart, fileSize.LowPart, nullptr);
+        if (mapping == nullptr)
+            throw std::runtime_error ("cannot map " + path);
+
+        bytes = (uint8_t*) MapViewOfFile (mapping, writing ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+        if (bytes == nullptr)
+            throw std::runtime_error ("cannot map " + path);
+    }
+
+    void close() noexcept {
+        if (bytes != nullptr)
+            UnmapViewOfFile (bytes);
+        if (mapping != nullptr)
+            CloseHandle (mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle (file);
+    }
+#else
+    int fd = -1;
+
+    void open (const std::string& path, const size_t newSize) {
+        const bool writing = newSize > 0;
+        fd                 = writing ? ::open (path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)
+                                     : ::open (path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error ("cannot open " + path);
+
+        if (writing) {
+            if (::ftruncate (fd, (off_t) newSize) != 0)
+                throw std::runtime_error ("cannot resize " + path);
+            length = newSize;
+        } else {
+            struct stat info;
+            if (::fstat (fd, &info) != 0)
+                throw std::runtime_error ("cannot stat " + path);
+            length = (size_t) info.st_size;
+        }
+
+        if (length == 0)
+            return;
+
+        void* const mapped = ::mmap (nullptr, length, writing ? PROT_READ | PROT_WRITE : PROT_READ,
+                                     MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED)
+            throw std::runtime_error ("cannot map " + path);
+
+        bytes = (uint8_t*) mapped;
+        ::madvise (mapped, length, MADV_SEQUENTIAL);
+    }
+
+    void close() noexcept {
+        if (bytes != nullptr)
+            ::munmap (bytes, length);
+        if (fd >= 0)
+            ::close (fd);
+    }
+#endif
+};
+
+//==============================================================================
+/** Sample encodings roboverb-render reads and writes. */
+enum class Encoding { int16,
+                      int24,
+                      int32,
+                      float32 };
+
+int bytesPerSample (const Encoding encoding) noexcept {
+    switch (encoding) {
+        case Encoding::int16: return 2;
+        case Encoding::int24: return 3;
+        case Encoding::int32: return 4;
+        case Encoding::float32: return 4;
+    }
+    return 0;
+}
+
+uint32_t readLE (const uint8_t* p, const int numBytes) noexcept {
+    uint32_t value = 0;
+    for (int i = numBytes; --i >= 0;)
+        value = (value << 8) | p[i];
+    return value;
+}
+
+void writeLE (uint8_t* p, uint32_t value, const int numBytes) noexcept {
+    for (int i = 0; i < numBytes; ++i, value >>= 8)
+        p[i] = (uint8_t) value;
+}
+
+/** Where the sample frames of a WAV file are and how they are stored. */
+struct WavInfo {
+    Encoding encoding = Encoding::int16;
+    int numChannels   = 0;
+    uint32_t sampleRate = 0;
+    const uint8_t* frames = nullptr;
+    size_t numFrames      = 0;
+};
+
+WavInfo parseWav (const MappedFile& file, const std::string& path) {
+    const uint8_t* const data = file.data();
+    const size_t size         = file.size();
+    if (size < 12 || std::memcmp (data, "RIFF", 4) != 0 || std::memcmp (data + 8, "WAVE", 4) != 0)
+        throw std::runtime_error (path + " is not a WAV file");
+
+    WavInfo info;
+    bool haveFormat = false;
+    int bits = 0, tag = 0;
+
+    for (size_t pos = 12; pos + 8 <= size;) {
+        const uint8_t* const chunk = data + pos;
+        const size_t chunkSize     = std::min ((size_t) readLE (chunk + 4, 4), size - pos - 8);
+
+        if (std::memcmp (chunk, "fmt ", 4) == 0 && chunkSize >= 16) {
+            tag              = (int) readLE (chunk + 8, 2);
+            info.numChannels = (int) readLE (chunk + 10, 2);
+            info.sampleRate  = readLE (chunk + 12, 4);
+            bits             = (int) readLE (chunk + 22, 2);
+            // WAVE_FORMAT_EXTENSIBLE keeps the real tag in its sub-format
+            if (tag == 0xfffe && chunkSize >= 40)
+                tag = (int) readLE (chunk + 32, 2);
+            haveFormat = true;
+        } else if (std::memcmp (chunk, "data", 4) == 0 && haveFormat) {
+            if (tag == 1 && bits == 16)
+                info.encoding = Encoding::int16;
+            else if (tag == 1 && bits == 24)
+                info.encoding = Encoding::int24;
+            else if (tag == 1 && bits == 32)
+                info.encoding = Encoding::int32;
+            else if (tag == 3 && bits == 32)
+                info.encoding = Encoding::float32;
+            else
+                throw std::runtime_error (path + ": unsupported sample format");
+
+            if (info.numChannels < 1 || info.numChannels > 2)
+                throw std::runtime_error (path + ": only mono and stereo files are supported");
+            if (info.sampleRate == 0)
+                throw std::runtime_error (path + ": invalid sample rate");
+
+            info.frames    = chunk + 8;
+            info.numFrames = chunkSize / ((size_t) info.numChannels * bytesPerSample (info.encoding));
+            return info;
+        }
+
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    throw std::runtime_error (path + ": no audio data");
+}
+
+/** Size of the canonical header writeWavHeader() produces. */
+constexpr size_t wavHeaderSize = 44;
+
+void writeWavHeader (uint8_t* p, const Encoding encoding, const uint32_t sampleRate, const size_t numFrames) {
+    const int numChannels = 2;
+    const int sampleBytes = bytesPerSample (encoding);
+    const size_t dataSize = numFrames * numChannels * sampleBytes;
+    if (dataSize > 0xffffffffu - wavHeaderSize)
+        throw std::runtime_error ("output is too long for a WAV file");
+
+    std::memcpy (p, "RIFF", 4);
+    writeLE (p + 4, (uint32_t) (wavHeaderSize - 8 + dataSize), 4);
+    std::memcpy (p + 8, "WAVEfmt ", 8);
+    writeLE (p + 16, 16, 4);
+    writeLE (p + 20, encoding == Encoding::float32 ? 3 : 1, 2);
+    writeLE (p + 22, numChannels, 2);
+    writeLE (p + 24, sampleRate, 4);
+    writeLE (p + 28, sampleRate * numChannels * sampleBytes, 4);
+    writeLE (p + 32, numChannels * sampleBytes, 2);
+    writeLE (p + 34, sampleBytes * 8, 2);
+    std::memcpy (p + 36, "data", 4);
+    writeLE (p + 40, (uint32_t) dataSize, 4);
+}
+
+float decodeSample (const uint8_t* p, const Encoding encoding) noexcept {
+    switch (encoding) {
+        case Encoding::int16:
+            return (float) (int16_t) readLE (p, 2) * (1.0f / 32768.0f);
+        case Encoding::int24:
+            return (float) ((int32_t) (readLE (p, 3) << 8) >> 8) * (1.0f / 8388608.0f);
+        case Encoding::int32:
+            return (float) ((double) (int32_t) readLE (p, 4) * (1.0 / 2147483648.0));
+        case Encoding::float32: {
+            const uint32_t bits = readLE (p, 4);
+            float value;
+            std::memcpy (&value, &bits, sizeof (float));
+            return value;
+        }
+    }
+    return 0.0f;
+}
+
+/** Scales to the integer range of `numBits` and clips. */
+uint32_t quantize (const float sample, const int numBits) noexcept {
+    const double scale = (double) (1u << (numBits - 1));
+    const double value = std::max (-scale, std::min (scale - 1.0, std::nearbyint ((double) sample * scale)));
+    return (uint32_t) (int32_t) value;
+}
+
+void encodeSample (uint8_t* p, const float sample, const Encoding encoding) noexcept {
+    switch (encoding) {
+        case Encoding::int16: writeLE (p, quantize (sample, 16), 2); break;
+        case Encoding::int24: writeLE (p, quantize (sample, 24), 3); break;
+        case Encoding::int32: writeLE (p, quantize (sample, 32), 4); break;
+        case Encoding::float32: {
+            uint32_t bits;
+            std::memcpy (&bits, &sample, sizeof (float));
+            writeLE (p, bits, 4);
+            break;
+        }
+    }
+}
+
+//==============================================================================
+struct Settings {
+    Roboverb::Parameters parameters;
+    bool combs[8]     = { false, false, false, true, true, true, false, false };
+    bool allPasses[4] = { true, true, false, false };
+    bool sameEncoding = true;
+    Encoding encoding = Encoding::float32;
+    double tailSeconds = 0.0;
+    std::string outputDir;
+    unsigned numThreads = 0;
+};
+
+std::string outputPath (const std::string& input, const Settings& settings) {
+    const size_t slash = input.find_last_of ("/\\");
+    const size_t dot   = input.find_last_of ('.');
+    const size_t start = slash == std::string::npos ? 0 : slash + 1;
+    const std::string stem = input.substr (start, dot == std::string::npos || dot < start ? std::string::npos : dot - start);
+
+    const std::string dir = settings.outputDir.empty() ? input.substr (0, start) : settings.outputDir + "/";
+    return dir + stem + "-roboverb.wav";
+}
+
+/** One input and the output it is rendered into. */
+struct Job {
+    std::unique_ptr<MappedFile> in, out;
+    WavInfo info;
+    Encoding outEncoding = Encoding::float32;
+    size_t numFrames     = 0;
+    const uint8_t* src   = nullptr;
+    uint8_t* dst         = nullptr;
+};
+
+/** Maps an input and creates its output, header and all. */
+Job openJob (const std::string& inPath, const Settings& settings) {
+    Job job;
+    job.in   = std::make_unique<MappedFile> (inPath);
+    job.info = parseWav (*job.in, inPath);
+
+    job.outEncoding          = settings.sameEncoding ? job.info.encoding : settings.encoding;
+    const size_t tailFrames  = (size_t) std::ceil (settings.tailSeconds * job.info.sampleRate);
+    job.numFrames            = job.info.numFrames + tailFrames;
+    const int outSampleBytes = bytesPerSample (job.outEncoding);
+
+    // the header is written first so an oversized output fails before the
+    // file is created
+    uint8_t header[wavHeaderSize];
+    writeWavHeader (header, job.outEncoding, job.info.sampleRate, job.numFrames);
+
+    job.out = std::make_unique<MappedFile> (outputPath (inPath, settings), wavHeaderSize + job.numFrames * 2 * outSampleBytes);
+    std::memcpy (job.out->data(), header, wavHeaderSize);
+
+    job.src = job.info.frames;
+    job.dst = job.out->data() + wavHeaderSize;
+    return job;
+}
+
+/** Renders jobs of one sample rate in lockstep, each on its own instance
+    of a bank.  A job that has ended runs on silence and its output is
+    dropped until the longest one is done. */
+void renderJobs (Job* const jobs, const int numJobs, const Settings& settings) {
+    RoboverbBank bank (numJobs);
+    for (int j = 0; j < numJobs; ++j) {
+        for (int i = 0; i < 8; ++i)
+            bank.setCombToggle (j, i, settings.combs[i]);
+        for (int i = 0; i < 4; ++i)
+            bank.setAllPassToggle (j, i, settings.allPasses[i]);
+        bank.setParameters (j, settings.parameters);
+    }
+    bank.setSampleRate (jobs[0].info.sampleRate);
+
+    std::vector<std::vector<float>> left ((size_t) numJobs, std::vector<float> (renderBlockSize));
+    std::vector<std::vector<float>> right ((size_t) numJobs, std::vector<float> (renderBlockSize));
+    std::vector<const float*> inputs[2];
+    std::vector<float*> outputs[2];
+    size_t numFrames = 0;
+    for (int j = 0; j < numJobs; ++j) {
+        inputs[0].push_back (left[(size_t) j].data());
+        inputs[1].push_back (right[(size_t) j].data());
+        outputs[0].push_back (left[(size_t) j].data());
+        outputs[1].push_back (right[(size_t) j].data());
+        numFrames = std::max (numFrames, jobs[j].numFrames);
+    }
+
+    for (size_t pos = 0; pos < numFrames; pos += renderBlockSize) {
+        const int len = (int) std::min (numFrames - pos, (size_t) renderBlockSize);
+
+        for (int j = 0; j < numJobs; ++j) {
+            Job& job             = jobs[j];
+            const WavInfo& info  = job.info;
+            const int frameBytes = info.numChannels * bytesPerSample (info.encoding);
+            const int numRead    = (int) std::min ((size_t) len, pos < info.numFrames ? info.numFrames - pos : 0);
+            float* const l       = left[(size_t) j].data();
+            float* const r       = right[(size_t) j].data();
+
+            for (int i = 0; i < numRead; ++i, job.src += frameBytes) {
+                l[i] = decodeSample (job.src, info.encoding);
+                r[i] = info.numChannels > 1 ? decodeSample (job.src + bytesPerSample (info.encoding), info.encoding) : l[i];
+            }
+            std::fill (l + numRead, l + len, 0.0f);
+            std::fill (r + numRead, r + len, 0.0f);
+        }
+
+        bank.processStereo (inputs[0].data(), inputs[1].data(), outputs[0].data(), outputs[1].data(), len);
+
+        for (int j = 0; j < numJobs; ++j) {
+            Job& job                 = jobs[j];
+            const int outSampleBytes = bytesPerSample (job.outEncoding);
+            const int numWritten     = (int) std::min ((size_t) len, pos < job.numFrames ? job.numFrames - pos : 0);
+            const float* const l     = left[(size_t) j].data();
+            const float* const r     = right[(size_t) j].data();
+
+            for (int i = 0; i < numWritten; ++i, job.dst += 2 * outSampleBytes) {
+                encodeSample (job.dst, l[i], job.outEncoding);
+                encodeSample (job.dst + outSampleBytes, r[i], job.outEncoding);
+            }
+        }
+    }
+}
+
+//==============================================================================
+void printUsage() {
+    std::fprintf (stderr,
+                  "usage: roboverb-render [options] input.wav...\n"
+                  "\n"
+                  "Writes <input>-roboverb.wav for every input, as stereo.\n"
+                  "\n"
+                  "  --room-size X      0 to 1 (default 0.5)\n"
+                  "  --damping X        0 to 1 (default 0.5)\n"
+                  "  --wet X            0 to 1 (default 0.33)\n"
+                  "  --dry X            0 to 1 (default 0.4)\n"
+                  "  --width X          0 to 1 (default 1)\n"
+                  "  --freeze           hold the tail forever\n"
+                  "  --combs LIST       enabled combs, e.g. 3,4,5 or none\n"
+                  "  --allpasses LIST   enabled allpasses, e.g. 0,1 or none\n"
+                  "  --format F         same, int16, int24, int32 or float (default same)\n"
+                  "  --tail SECONDS     silence rendered after the input (default 0)\n"
+                  "  --output DIR       directory for the rendered files\n"
+                  "  --jobs N           worker threads (default: one per core)\n");
+}
+
+float parseLevel (const char* arg) {
+    char* end         = nullptr;
+    const float value = std::strtof (arg, &end);
+    if (end == arg || *end != '\0' || ! (value >= 0.0f && value <= 1.0f))
+        throw std::runtime_error (std::string ("invalid level: ") + arg);
+    return value;
+}
+
+double parseSeconds (const char* arg) {
+    char* end          = nullptr;
+    const double value = std::strtod (arg, &end);
+    if (end == arg || *end != '\0' || ! (value >= 0.0 && value <= 3600.0))
+        throw std::runtime_error (std::string ("invalid duration: ") + arg);
+    return value;
+}
+
+unsigned parseCount (const char* arg) {
+    char* end        = nullptr;
+    const long value = std::strtol (arg, &end, 10);
+    if (end == arg || *end != '\0' || value < 1 || value > 1024)
+        throw std::runtime_error (std::string ("invalid count: ") + arg);
+    return (unsigned) value;
+}
+
+template <int NumFilters>
+void parseToggles (const std::string& arg, bool (&toggles)[NumFilters]) {
+    std::fill (toggles, toggles + NumFilters, false);
+    if (arg == "none")
+        return;
+
+    for (size_t pos = 0; pos <= arg.size();) {
+        const size_t comma = std::min (arg.find (',', pos), arg.size());
+        const std::string item = arg.substr (pos, comma - pos);
+        if (item.size() != 1 || item[0] < '0' || item[0] >= '0' + NumFilters)
+            throw std::runtime_error ("invalid filter list: " + arg);
+        toggles[item[0] - '0'] = true;
+        pos                    = comma + 1;
+    }
+}
+
+Encoding parseEncoding (const std::string& arg, bool& same) {
+    same = arg == "same";
+    if (same || arg == "float")
+        return Encoding::float32;
+    if (arg == "int16")
+        return Encoding::int16;
+    if (arg == "int24")
+        return Encoding::int24;
+    if (arg == "int32")
+        return Encoding::int32;
+    throw std::runtime_error ("invalid format: " + arg);
+}
+
+} // namespace
+
+int main (int argc, char** argv) {
+    Settings settings;
+    std::vector<std::string> inputs;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help") {
+                printUsage();
+                return 0;
+            }
+
+            if (arg == "--freeze") {
+                settings.parameters.freezeMode = 1.0f;
+                continue;
+            }
+
+            if (arg.empty() || arg[0] != '-') {
+                inputs.push_back (arg);
+                continue;
+            }
+
+            static const char* const valueOptions[] = { "--room-size", "--damping", "--wet", "--dry", "--width",
+                                                        "--combs", "--allpasses", "--format", "--tail", "--output",
+                                                        "--jobs" };
+            if (std::find (std::begin (valueOptions), std::end (valueOptions), arg) == std::end (valueOptions))
+                throw std::runtime_error ("unknown option " + arg);
+            if (i + 1 >= argc)
+                throw std::runtime_error ("missing value for " + arg);
+            const char* const value = argv[++i];
+
+            if (arg == "--room-size")
+                settings.parameters.roomSize = parseLevel (value);
+            else if (arg == "--damping")
+                settings.parameters.damping = parseLevel (value);
+            else if (arg == "--wet")
+                settings.parameters.wetLevel = parseLevel (value);
+            else if (arg == "--dry")
+                settings.parameters.dryLevel = parseLevel (value);
+            else if (arg == "--width")
+                settings.parameters.width = parseLevel (value);
+            else if (arg == "--combs")
+                parseToggles (value, settings.combs);
+            else if (arg == "--allpasses")
+                parseToggles (value, settings.allPasses);
+            else if (arg == "--format")
+                settings.encoding = parseEncoding (value, settings.sameEncoding);
+            else if (arg == "--tail")
+                settings.tailSeconds = parseSeconds (value);
+            else if (arg == "--output")
+                settings.outputDir = value;
+            else if (arg == "--jobs")
+                settings.numThreads = parseCount (value);
+            else
+                throw std::runtime_error ("unknown option " + arg);
+        }
+    } catch (const std::exception& e) {
+        std::fprintf (stderr, "roboverb-render: %s\n", e.what());
+        printUsage();
+        return 1;
+    }
+
+    if (inputs.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    unsigned numThreads = settings.numThreads > 0 ? settings.numThreads : std::thread::hardware_concurrency();
+    numThreads          = std::max (1u, std::min (numThreads, (unsigned) inputs.size()));
+
+    // a batch fills at most one bank group, and batches shrink rather than
+    // leave threads idle when there are few files
+    const size_t lanes     = (size_t) roboverb::kernels::select().bank.lanes;
+    const size_t batchSize = std::min (lanes, (inputs.size() + numThreads - 1) / numThreads);
+    numThreads             = (unsigned) ((inputs.size() + batchSize - 1) / batchSize);
+
+    // workers pull the next batch of files off a shared counter until none
+    // are left
+    std::atomic<size_t> nextInput { 0 };
+    std::atomic<int> numFailed { 0 };
+
+    // anything a worker can't pin on one file stops every worker and is
+    // reported here once they have all finished
+    std::vector<std::exception_ptr> errors (numThreads);
+
+    auto work = [&] (const unsigned worker) {
+        // long tails decay through the denormal range, as in the plugins
+        const roboverb::ScopedNoDenormals noDenormals;
+
+        try {
+            for (size_t first; (first = nextInput.fetch_add (batchSize)) < inputs.size();) {
+                std::vector<Job> jobs;
+                for (size_t index = first; index < std::min (first + batchSize, inputs.size()); ++index) {
+                    try {
+                        jobs.push_back (openJob (inputs[index], settings));
+                    } catch (const std::exception& e) {
+                        std::fprintf (stderr, "roboverb-render: %s\n", e.what());
+                        ++numFailed;
+                    }
+                }
+
+                // the bank runs at one sample rate, so each rate gets its own
+                std::stable_sort (jobs.begin(), jobs.end(), [] (const Job& a, const Job& b) {
+                    return a.info.sampleRate < b.info.sampleRate;
+                });
+                for (size_t start = 0, end; start < jobs.size(); start = end) {
+                    for (end = start + 1; end < jobs.size() && jobs[end].info.sampleRate == jobs[start].info.sampleRate;)
+                        ++end;
+                    renderJobs (jobs.data() + start, (int) (end - start), settings);
+                }
+            }
+        } catch (...) {
+            errors[worker] = std::current_exception();
+            nextInput      = inputs.size();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < numThreads; ++i)
+        pool.emplace_back (work, i);
+    work (0);
+    for (auto& thread : pool)
+        thread.join();
+
+    for (const auto& error : errors) {
+        if (error == nullptr)
+            continue;
+        try {
+            std::rethrow_exception (error);
+        } catch (const std::exception& e) {
+            std::fprintf (stderr, "roboverb-render: %s\n", e.what());
+        } catch (...) {
+            std::fprintf (stderr, "roboverb-render: unknown error\n");
+        }
+        return 1;
+    }
+
+    return numFailed > 0 ? 1 : 0;
+}
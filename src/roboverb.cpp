@@ -17,4 +17,485 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <cmath>
+
 #include "roboverb.hpp"
+
+/** Renders up to maxBlockSize frames one filter at a time: every comb runs
+    over the whole block into the wet accumulators, then each allpass runs
+    over the accumulated block in series, then the wet and dry signals are
+    mixed in a separate pass.  The loops themselves are the kernels picked
+    for this CPU.
+
+    Parameter ramps are only rendered while a value is actually moving;
+    settled values take the constant-gain paths. */
+template <int NumCombs, int NumAllPasses>
+void Roboverb::renderStereoBlock (const float* const left, const float* const right,
+                                  float* const out1, float* const out2,
+                                  const int numSamples) noexcept {
+    renderWetBlock<NumCombs, NumAllPasses> (left, right, numSamples);
+    mixBlock (wet[0], wet[1], left, right, out1, out2, numSamples);
+}
+
+/** Mixes up to maxBlockSize frames of wet signal with the dry input. */
+void Roboverb::mixBlock (const float* const wetL, const float* const wetR,
+                         const float* const left, const float* const right,
+                         float* const out1, float* const out2,
+                         const int numSamples) noexcept {
+    if (dryGain.isSmoothing() || wetGain1.isSmoothing() || wetGain2.isSmoothing()) {
+        dryGain.render (dryBlock, numSamples);
+        wetGain1.render (wetBlock[0], numSamples);
+        wetGain2.render (wetBlock[1], numSamples);
+        kernels->mixRamped (wetL, wetR, left, right, out1, out2, dryBlock, wetBlock[0], wetBlock[1], numSamples);
+    } else {
+        const float dry = dryGain.getTargetValue(), wet1 = wetGain1.getTargetValue(), wet2 = wetGain2.getTargetValue();
+        kernels->mix (wetL, wetR, left, right, out1, out2, &dry, &wet1, &wet2, numSamples);
+    }
+}
+
+/** Renders one channel's network over the shared parallel block.  Combs
+    are run two at a time into the same accumulator, in the order the
+    serial path adds them, and switch between the plain and ramped kernels
+    at the same maxBlockSize boundaries, so the result is bit-identical to
+    serial processing. */
+template <int NumCombs, int NumAllPasses>
+void Roboverb::renderChannel (const int channel) noexcept {
+    ParallelBlock& block = *parallel;
+    const int numSamples = block.numSamples;
+    float* const out     = block.wet[channel];
+    std::fill_n (out, numSamples, 0.0f);
+
+    for (int i = 0; i < numSamples; i += maxBlockSize) {
+        const int n           = std::min (numSamples - i, (int) maxBlockSize);
+        const bool ramped     = block.ramped[i / maxBlockSize];
+        const auto pair       = ramped ? kernels->combRamped : kernels->comb;
+        const auto single     = ramped ? kernels->combLineRamped : kernels->combLine;
+        const auto halfPair   = ramped ? kernels->half.combRamped : kernels->half.comb;
+        const auto halfSingle = ramped ? kernels->half.combLineRamped : kernels->half.combLine;
+        const float* damp     = block.damp + i;
+        const float* fb       = block.feedback + i;
+
+        int k = 0;
+        for (; k + 1 < NumCombs; k += 2)
+            combs.processChannelBlock (pair, halfPair, channel, k, 2, block.input + i, damp, fb, out + i, n);
+        if (k < NumCombs)
+            combs.processChannelBlock (single, halfSingle, channel, k, 1, block.input + i, damp, fb, out + i, n);
+    }
+
+    for (int k = 0; k < NumAllPasses; ++k)
+        allPass[channel][activeAllPasses[k]].processBlock (kernels->allPass, kernels->half.allPass, out, numSamples);
+}
+
+/** Smooths damping and feedback over the first numSamples frames of the
+    parallel block's input, then renders the two channels' networks as
+    tasks, or in turn if the runner declines. */
+void Roboverb::runParallel (const int numSamples) noexcept {
+    ParallelBlock& block = *parallel;
+    block.numSamples     = numSamples;
+    for (int i = 0; i < numSamples; i += maxBlockSize) {
+        const int n  = std::min (numSamples - i, (int) maxBlockSize);
+        bool& ramped = block.ramped[i / maxBlockSize];
+        ramped       = damping.isSmoothing() || feedback.isSmoothing();
+        if (ramped) {
+            damping.render (block.damp + i, n);
+            feedback.render (block.feedback + i, n);
+        } else {
+            block.damp[i]     = damping.getTargetValue();
+            block.feedback[i] = feedback.getTargetValue();
+        }
+    }
+
+    if (! taskRunner (taskContext, numChannels))
+        for (int c = 0; c < numChannels; ++c)
+            runTask (c);
+}
+
+void Roboverb::renderParallel (const float* const left, const float* const right,
+                               float* const out1, float* const out2,
+                               const int numSamples) noexcept {
+    ParallelBlock& block = *parallel;
+    for (int pos = 0; pos < numSamples; pos += ParallelBlock::size) {
+        const int len = std::min (numSamples - pos, (int) ParallelBlock::size);
+        kernels->input (left + pos, right + pos, gain, block.input, len);
+        runParallel (len);
+
+        for (int i = 0; i < len; i += maxBlockSize) {
+            const int n = std::min (len - i, (int) maxBlockSize);
+            mixBlock (block.wet[0] + i, block.wet[1] + i, left + pos + i, right + pos + i,
+                      out1 + pos + i, out2 + pos + i, n);
+        }
+    }
+}
+
+void Roboverb::setTaskRunner (const TaskRunner runner, void* const context, const int minBlockSize) {
+    if (runner != nullptr && parallel == nullptr)
+        parallel.reset (new ParallelBlock());
+
+    taskRunner           = runner;
+    taskContext          = context;
+    parallelMinBlockSize = minBlockSize;
+}
+
+/** Runs the comb and allpass network over a block, leaving the two wet
+    channels in wet[0] and wet[1]. */
+template <int NumCombs, int NumAllPasses>
+void Roboverb::renderWetBlock (const float* const left, const float* const right,
+                               const int numSamples) noexcept {
+    kernels->input (left, right, gain, input, numSamples);
+
+    std::fill_n (wet[0], numSamples, 0.0f);
+    std::fill_n (wet[1], numSamples, 0.0f);
+
+    if (damping.isSmoothing() || feedback.isSmoothing()) {
+        damping.render (dampBlock, numSamples);
+        feedback.render (feedBlock, numSamples);
+        for (int k = 0; k < NumCombs; ++k)
+            combs.processBlock (kernels->combRamped, kernels->half.combRamped, k, input, dampBlock, feedBlock, wet[0], wet[1], numSamples);
+    } else {
+        const float damp = damping.getTargetValue(), feedbck = feedback.getTargetValue();
+        for (int k = 0; k < NumCombs; ++k)
+            combs.processBlock (kernels->comb, kernels->half.comb, k, input, &damp, &feedbck, wet[0], wet[1], numSamples);
+    }
+
+    for (int k = 0; k < NumAllPasses; ++k) {
+        const int j = activeAllPasses[k];
+        allPass[0][j].processBlock (kernels->allPass, kernels->half.allPass, wet[0], numSamples);
+        allPass[1][j].processBlock (kernels->allPass, kernels->half.allPass, wet[1], numSamples);
+    }
+}
+
+/** Mixes wetL and wetR with the dry input at the precision of the I/O
+    buffers. */
+template <typename Sample>
+void Roboverb::mixStereo (const float* const wetL, const float* const wetR,
+                          const Sample* const left, const Sample* const right,
+                          Sample* const out1, Sample* const out2,
+                          const int numSamples) noexcept {
+    const bool ramped = dryGain.isSmoothing() || wetGain1.isSmoothing() || wetGain2.isSmoothing();
+    if (ramped) {
+        dryGain.render (dryBlock, numSamples);
+        wetGain1.render (wetBlock[0], numSamples);
+        wetGain2.render (wetBlock[1], numSamples);
+    }
+
+    const float dry = dryGain.getTargetValue(), wet1 = wetGain1.getTargetValue(), wet2 = wetGain2.getTargetValue();
+    for (int i = 0; i < numSamples; ++i) {
+        const Sample g  = ramped ? dryBlock[i] : dry;
+        const Sample w1 = ramped ? wetBlock[0][i] : wet1;
+        const Sample w2 = ramped ? wetBlock[1][i] : wet2;
+        const Sample l = wetL[i], r = wetR[i];
+        const Sample inL = left[i], inR = right[i];
+        out1[i]          = l * w1 + r * w2 + inL * g;
+        out2[i]          = r * w1 + l * w2 + inR * g;
+    }
+}
+
+void Roboverb::processStereo (const double* const left, const double* const right,
+                              double* const out1, double* const out2,
+                              const int numSamples) noexcept {
+    const bool inputSilent = isSilent (left, numSamples) && isSilent (right, numSamples);
+    if (inputSilent && skipSilence (numSamples)) {
+        std::fill_n (out1, numSamples, 0.0);
+        std::fill_n (out2, numSamples, 0.0);
+        return;
+    }
+
+    if (rateFactor > 1) {
+        renderReduced (left, right, out1, out2, numSamples);
+        trackTail (inputSilent, inputSilent && isSilent (out1, numSamples) && isSilent (out2, numSamples), numSamples);
+        return;
+    }
+
+    for (int pos = 0; pos < numSamples; pos += maxBlockSize) {
+        const int len = std::min (numSamples - pos, (int) maxBlockSize);
+        for (int i = 0; i < len; ++i) {
+            inputBlock[0][i] = static_cast<float> (left[pos + i]);
+            inputBlock[1][i] = static_cast<float> (right[pos + i]);
+        }
+
+        (this->*renderers.wet) (inputBlock[0], inputBlock[1], len);
+        mixStereo (wet[0], wet[1], left + pos, right + pos, out1 + pos, out2 + pos, len);
+    }
+
+    trackTail (inputSilent, inputSilent && isSilent (out1, numSamples) && isSilent (out2, numSamples), numSamples);
+}
+
+/** Float output goes through the mix kernels. */
+template <>
+void Roboverb::mixStereo (const float* const wetL, const float* const wetR,
+                          const float* const left, const float* const right,
+                          float* const out1, float* const out2,
+                          const int numSamples) noexcept {
+    mixBlock (wetL, wetR, left, right, out1, out2, numSamples);
+}
+
+/** Decimates up to maxBlockSize frames of input to the network's rate,
+    renders the wet signal there and interpolates it back up to mix with the
+    dry signal at the host rate. */
+template <typename Sample>
+void Roboverb::renderReduced (const Sample* const left, const Sample* const right,
+                              Sample* const out1, Sample* const out2,
+                              const int numSamples) noexcept {
+    if (blockProcessing && taskRunner != nullptr && numSamples >= parallelMinBlockSize) {
+        renderReducedParallel (left, right, out1, out2, numSamples);
+        return;
+    }
+
+    for (int pos = 0; pos < numSamples; pos += maxBlockSize) {
+        const int len = std::min (numSamples - pos, (int) maxBlockSize);
+        const int n   = decimator.process (left + pos, right + pos, len, inputBlock[0], inputBlock[1]);
+
+        if (n > 0)
+            (this->*renderers.wet) (inputBlock[0], inputBlock[1], n);
+        interpolator.process (wet[0], wet[1], n, hostWet[0], hostWet[1], len);
+
+        mixStereo (hostWet[0], hostWet[1], left + pos, right + pos, out1 + pos, out2 + pos, len);
+    }
+}
+
+/** Mixes a mono wet block with the dry input at the precision of the
+    I/O buffer. */
+template <typename Sample>
+void Roboverb::mixMono (const float* const wetIn, Sample* const samples, const int numSamples) noexcept {
+    const bool ramped = dryGain.isSmoothing() || wetGain1.isSmoothing();
+    if (ramped) {
+        dryGain.render (dryBlock, numSamples);
+        wetGain1.render (wetBlock[0], numSamples);
+    }
+
+    const float dry = dryGain.getTargetValue(), wet1 = wetGain1.getTargetValue();
+    for (int i = 0; i < numSamples; ++i) {
+        const Sample g  = ramped ? dryBlock[i] : dry;
+        const Sample w1 = ramped ? wetBlock[0][i] : wet1;
+        samples[i]      = static_cast<Sample> (wetIn[i]) * w1 + samples[i] * g;
+    }
+}
+
+/** Float output goes through the mono mix kernels. */
+template <>
+void Roboverb::mixMono (const float* const wetIn, float* const samples, const int numSamples) noexcept {
+    if (dryGain.isSmoothing() || wetGain1.isSmoothing()) {
+        dryGain.render (dryBlock, numSamples);
+        wetGain1.render (wetBlock[0], numSamples);
+        kernels->mixMonoRamped (wetIn, samples, samples, dryBlock, wetBlock[0], numSamples);
+    } else {
+        const float dry = dryGain.getTargetValue(), wet1 = wetGain1.getTargetValue();
+        kernels->mixMono (wetIn, samples, samples, &dry, &wet1, numSamples);
+    }
+}
+
+/** The block path of processMono(): the left network runs a block at a
+    time on the comb and allpass kernels, as renderChannel() does for one
+    channel of a stereo instance. */
+template <typename Sample>
+void Roboverb::renderMonoBlock (Sample* const samples, const int numSamples) noexcept {
+    for (int pos = 0; pos < numSamples; pos += maxBlockSize) {
+        const int len = std::min (numSamples - pos, (int) maxBlockSize);
+        for (int i = 0; i < len; ++i)
+            inputBlock[0][i] = static_cast<float> (samples[pos + i]);
+
+        (this->*renderers.monoWet) (inputBlock[0], len);
+        mixMono (wet[0], samples + pos, len);
+    }
+}
+
+/** renderReduced() with the channels' networks run as tasks.  Up to a
+    ParallelBlock of host frames is decimated into the parallel block
+    first, so the tasks see as many network frames at once as they can. */
+template <typename Sample>
+void Roboverb::renderReducedParallel (const Sample* const left, const Sample* const right,
+                                      Sample* const out1, Sample* const out2,
+                                      const int numSamples) noexcept {
+    ParallelBlock& block = *parallel;
+    int counts[ParallelBlock::size / maxBlockSize]; // network frames per run of host frames
+
+    for (int pos = 0; pos < numSamples; pos += ParallelBlock::size) {
+        const int len = std::min (numSamples - pos, (int) ParallelBlock::size);
+
+        int n = 0;
+        for (int i = 0; i < len; i += maxBlockSize) {
+            const int run = i / maxBlockSize;
+            counts[run]   = decimator.process (left + pos + i, right + pos + i, std::min (len - i, (int) maxBlockSize),
+                                               inputBlock[0], inputBlock[1]);
+            kernels->input (inputBlock[0], inputBlock[1], gain, block.input + n, counts[run]);
+            n += counts[run];
+        }
+
+        if (n > 0)
+            runParallel (n);
+
+        for (int i = 0, offset = 0; i < len; i += maxBlockSize) {
+            const int m     = std::min (len - i, (int) maxBlockSize);
+            const int count = counts[i / maxBlockSize];
+            interpolator.process (block.wet[0] + offset, block.wet[1] + offset, count, hostWet[0], hostWet[1], m);
+            mixStereo (hostWet[0], hostWet[1], left + pos + i, right + pos + i, out1 + pos + i, out2 + pos + i, m);
+            offset += count;
+        }
+    }
+}
+
+/** The mono version of renderReduced(), which leaves the right lanes of
+    the resamplers idle. */
+template <typename Sample>
+void Roboverb::renderReducedMono (Sample* const samples, const int numSamples) noexcept {
+    for (int pos = 0; pos < numSamples; pos += maxBlockSize) {
+        const int len = std::min (numSamples - pos, (int) maxBlockSize);
+        const int n   = decimator.process (samples + pos, samples + pos, len, inputBlock[0], inputBlock[1]);
+
+        if (n > 0)
+            (this->*renderers.monoWet) (inputBlock[0], n);
+        interpolator.process (wet[0], wet[0], n, hostWet[0], hostWet[1], len);
+
+        mixMono (hostWet[0], samples + pos, len);
+    }
+}
+
+template void Roboverb::renderReduced (const float*, const float*, float*, float*, int) noexcept;
+template void Roboverb::renderMonoBlock (float*, int) noexcept;
+template void Roboverb::renderMonoBlock (double*, int) noexcept;
+template void Roboverb::renderReducedMono (float*, int) noexcept;
+template void Roboverb::renderReducedMono (double*, int) noexcept;
+
+template <int NumCombs, int NumAllPasses>
+void Roboverb::renderStereoSamples (const float* const left, const float* const right,
+                                    float* const out1, float* const out2,
+                                    const int numSamples) noexcept {
+    clearAhead<NumCombs, NumAllPasses> (2, numSamples);
+    for (int i = 0; i < numSamples; ++i) {
+        const float input = (left[i] + right[i]) * gain;
+        float outL = 0, outR = 0;
+
+        const float damp    = damping.getNextValue();
+        const float feedbck = feedback.getNextValue();
+
+        // accumulate the comb filters of both channels in parallel
+        combs.processStereo<roboverb::simd::native, NumCombs> (input, damp, feedbck, outL, outR);
+
+        for (int k = 0; k < NumAllPasses; ++k) // run the allpass filters in series
+        {
+            const int j = activeAllPasses[k];
+            outL        = allPass[0][j].process (outL);
+            outR        = allPass[1][j].process (outR);
+        }
+
+        const float dry  = dryGain.getNextValue();
+        const float wet1 = wetGain1.getNextValue();
+        const float wet2 = wetGain2.getNextValue();
+
+        out1[i] = outL * wet1 + outR * wet2 + left[i] * dry;
+        out2[i] = outR * wet1 + outL * wet2 + right[i] * dry;
+    }
+}
+
+template <int NumCombs, int NumAllPasses, typename Sample>
+void Roboverb::renderMono (Sample* const samples, const int numSamples) noexcept {
+    clearAhead<NumCombs, NumAllPasses> (1, numSamples);
+    for (int i = 0; i < numSamples; ++i) {
+        const float input = static_cast<float> (samples[i]) * gain;
+        float output      = 0;
+
+        const float damp    = damping.getNextValue();
+        const float feedbck = feedback.getNextValue();
+
+        for (int k = 0; k < NumCombs; ++k) // accumulate the comb filters in parallel
+            output += combs.process (2 * k, input, damp, feedbck);
+
+        for (int k = 0; k < NumAllPasses; ++k) // run the allpass filters in series
+            output = allPass[0][activeAllPasses[k]].process (output);
+
+        const float dry  = dryGain.getNextValue();
+        const float wet1 = wetGain1.getNextValue();
+
+        samples[i] = static_cast<Sample> (output) * wet1 + samples[i] * dry;
+    }
+}
+
+/** Runs the left network over up to maxBlockSize frames of mono input,
+    leaving the wet signal in wet[0].  Combs go two at a time into the one
+    accumulator, as in renderChannel(). */
+template <int NumCombs, int NumAllPasses>
+void Roboverb::renderMonoWet (const float* const in, const int numSamples) noexcept {
+    for (int i = 0; i < numSamples; ++i)
+        input[i] = in[i] * gain;
+
+    float* const out = wet[0];
+    std::fill_n (out, numSamples, 0.0f);
+
+    const bool ramped = damping.isSmoothing() || feedback.isSmoothing();
+    float damp = damping.getTargetValue(), feedbck = feedback.getTargetValue();
+    if (ramped) {
+        damping.render (dampBlock, numSamples);
+        feedback.render (feedBlock, numSamples);
+    }
+
+    const float* const d  = ramped ? dampBlock : &damp;
+    const float* const fb = ramped ? feedBlock : &feedbck;
+    const auto pair       = ramped ? kernels->combRamped : kernels->comb;
+    const auto single     = ramped ? kernels->combLineRamped : kernels->combLine;
+    const auto halfPair   = ramped ? kernels->half.combRamped : kernels->half.comb;
+    const auto halfSingle = ramped ? kernels->half.combLineRamped : kernels->half.combLine;
+
+    int k = 0;
+    for (; k + 1 < NumCombs; k += 2)
+        combs.processChannelBlock (pair, halfPair, 0, k, 2, input, d, fb, out, numSamples);
+    if (k < NumCombs)
+        combs.processChannelBlock (single, halfSingle, 0, k, 1, input, d, fb, out, numSamples);
+
+    for (int k = 0; k < NumAllPasses; ++k)
+        allPass[0][activeAllPasses[k]].processBlock (kernels->allPass, kernels->half.allPass, out, numSamples);
+}
+
+template <int NumCombs, int NumAllPasses>
+constexpr Roboverb::Renderers Roboverb::makeRenderers() noexcept {
+    return { &Roboverb::renderStereoBlock<NumCombs, NumAllPasses>,
+             &Roboverb::renderStereoSamples<NumCombs, NumAllPasses>,
+             &Roboverb::renderWetBlock<NumCombs, NumAllPasses>,
+             &Roboverb::renderMonoWet<NumCombs, NumAllPasses>,
+             &Roboverb::renderChannel<NumCombs, NumAllPasses>,
+             &Roboverb::renderMono<NumCombs, NumAllPasses, float>,
+             &Roboverb::renderMono<NumCombs, NumAllPasses, double> };
+}
+
+template <std::size_t... Index>
+constexpr std::array<Roboverb::Renderers, sizeof...(Index)>
+    Roboverb::makeRendererTable (std::index_sequence<Index...>) noexcept {
+    return { { makeRenderers<(int) (Index / (numAllPasses + 1)), (int) (Index % (numAllPasses + 1))>()... } };
+}
+
+void Roboverb::updateRenderers() noexcept {
+    static constexpr auto table = makeRendererTable (std::make_index_sequence<(numCombs + 1) * (numAllPasses + 1)>());
+    renderers                   = table[(size_t) (combs.getNumActive() * (numAllPasses + 1) + numActiveAllPasses)];
+}
+
+void Roboverb::updateTailSpan() noexcept {
+    int longestComb = 0;
+    for (int e = 0; e < 2 * combs.getNumActive(); ++e)
+        longestComb = std::max (longestComb, combs.getSize (e));
+
+    int allPassDelay = 0;
+    for (int c = 0; c < numChannels; ++c) {
+        int delay = 0;
+        for (int k = 0; k < numActiveAllPasses; ++k)
+            delay += allPass[c][activeAllPasses[k]].getSize();
+        allPassDelay = std::max (allPassDelay, delay);
+    }
+
+    // in host samples, plus a margin for the resamplers
+    tailSpan = (longestComb + allPassDelay) * rateFactor + (rateFactor - 1) * 16;
+}
+
+int Roboverb::getTailLength() const noexcept {
+    if (isFrozen (parameters.freezeMode))
+        return -1;
+
+    // Damping only lowers the high frequencies, so each trip around the
+    // longest comb scales the tail by the feedback at DC.
+    const double loopGain = feedback.getTargetValue();
+    const double trips    = std::ceil (std::log (silenceThreshold) / std::log (loopGain));
+
+    int longestComb = 0;
+    for (int e = 0; e < 2 * combs.getNumActive(); ++e)
+        longestComb = std::max (longestComb, combs.getSize (e));
+
+    return static_cast<int> (trips * longestComb) * rateFactor + tailSpan - longestComb * rateFactor;
+}
@@ -19,9 +19,19 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdint>
 #include <cstring>
 #include <memory>
+#include <utility>
+
+#include "halfband.hpp"
+#include "kernels.hpp"
+#include "simd.hpp"
+
+class RoboverbBank;
 
 class Roboverb {
 public:
@@ -35,18 +45,26 @@ public:
         numParameters
     };
 
-    Roboverb() {
+    /** Which delay networks an instance allocates. */
+    enum Layout {
+        Stereo, /**< Both channels, for processStereo(). */
+        Mono    /**< Only the left network, for processMono(); half the memory. */
+    };
+
+    explicit Roboverb (const Layout layout = Stereo)
+        : numLines (layout == Mono ? 1 : numChannels) {
         for (int i = 0; i < numCombs; ++i)
-            enabledCombs[i] = false;
-        enabledCombs[3] = true;
-        enabledCombs[4] = true;
-        enabledCombs[5] = true;
+            setCombToggle (i, false);
+        setCombToggle (3, true);
+        setCombToggle (4, true);
+        setCombToggle (5, true);
 
         for (int i = 0; i < numAllPasses; ++i)
-            enabledAllPasses[i] = false;
-        enabledAllPasses[0] = true;
-        enabledAllPasses[1] = true;
+            setAllPassToggle (i, false);
+        setAllPassToggle (0, true);
+        setAllPassToggle (1, true);
 
+        reserveArena();
         setParameters (Parameters());
         setSampleRate (44100.0);
     }
@@ -91,12 +109,12 @@ public:
 #if ROBOVERB_JUCE
     void swapEnabledCombs (BigInteger& e) {
         for (int i = 0; i < numCombs; ++i)
-            enabledCombs[i] = e[i];
+            setCombToggle (i, e[i]);
     }
 
     void swapEnabledAllPasses (BigInteger& e) {
         for (int i = 0; i < numAllPasses; ++i)
-            enabledAllPasses[i] = e[i];
+            setAllPassToggle (i, e[i]);
     }
 
     void getEnablement (BigInteger& c, BigInteger& a) const {
@@ -109,10 +127,21 @@ public:
 
     void setCombToggle (const int index, const bool toggled) {
         enabledCombs[index] = toggled;
+        combs.setEnabled (index, toggled);
+        updateRenderers();
+        updateTailSpan();
     }
 
     void setAllPassToggle (const int index, const bool toggled) {
         enabledAllPasses[index] = toggled;
+
+        numActiveAllPasses = 0;
+        for (int j = 0; j < numAllPasses; ++j)
+            if (enabledAllPasses[j])
+                activeAllPasses[numActiveAllPasses++] = j;
+
+        updateRenderers();
+        updateTailSpan();
     }
 
     float toggledCombFloat (const int index) const {
@@ -124,212 +153,880 @@ public:
     }
 
     void setParameters (const Parameters& newParams) {
-        const float wetScaleFactor = 6.0f;
-        const float dryScaleFactor = 2.0f;
+        parameters = newParams;
+        applyLevels();
+        applyRoom();
+    }
 
-        const float wet = newParams.wetLevel * wetScaleFactor;
-        dryGain.setValue (newParams.dryLevel * dryScaleFactor);
-        wetGain1.setValue (0.5f * wet * (1.0f + newParams.width));
-        wetGain2.setValue (0.5f * wet * (1.0f - newParams.width));
+    /** Changes the wet, dry and width levels, recomputing only the output
+        gains. */
+    void setLevels (const float wetLevel, const float dryLevel, const float width) {
+        parameters.wetLevel = wetLevel;
+        parameters.dryLevel = dryLevel;
+        parameters.width    = width;
+        applyLevels();
+    }
 
-        gain       = isFrozen (newParams.freezeMode) ? 0.0f : 0.015f;
-        parameters = newParams;
-        updateDamping();
+    /** Changes the room size and damping, recomputing only the comb
+        coefficients. */
+    void setRoom (const float roomSize, const float damping) {
+        parameters.roomSize = roomSize;
+        parameters.damping  = damping;
+        applyRoom();
     }
 
-    void setSampleRate (const double sampleRate) {
-        //static const short combTunings[] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 }; // (at 44100Hz)
-        static const short combTunings[]    = { 8092, 4096, 2048, 1024, 512, 256, 128, 64 }; // (at 44100Hz)
-        static const short allPassTunings[] = { 556, 441, 341, 225 };
-        const int stereoSpread              = 23;
-        const int intSampleRate             = (int) sampleRate;
+    /** Highest sample rate the delay-line arena is reserved for up front.
+        Higher rates still work but grow the arena when first set. */
+    static constexpr double maxSampleRate = 192000.0;
+
+    /** Switches between the Stereo and Mono layouts.  Reallocates and
+        clears the delay lines, so it is not real-time safe. */
+    void setLayout (const Layout layout) {
+        const int lines = layout == Mono ? 1 : (int) numChannels;
+        if (lines == numLines)
+            return;
+
+        numLines = lines;
+        arena.release();
+        reserveArena();
+        setSampleRate (currentSampleRate);
+    }
+
+    Layout getLayout() const noexcept { return numLines == 1 ? Mono : Stereo; }
+
+    /** Runs the comb and allpass network at half or a quarter of the host
+        rate when that is 88.2 kHz or more, so 44.1 or 48 kHz at the usual
+        rates.  The input is decimated for the network and the wet signal
+        interpolated back up; the dry signal and the mix stay at the host
+        rate.  Always uses block processing; with a task runner, the two
+        channels' networks run as separate tasks as they do at full rate.
+
+        At 96 and 192 kHz the network renders 2 and 4 times fewer samples
+        and the delay lines shrink to match.  The resamplers, an IIR
+        half-band filter per octave in each direction, take back part of
+        that: with every filter on, processing gets about 1.5 times cheaper
+        at 96 kHz and 2.8 times at 192 kHz.  The wet signal is band-limited
+        to just under 24 kHz and peaks about 7 samples (96 kHz) or 18
+        samples (192 kHz) later, under 0.1 ms.  Only the wet signal is
+        delayed, so there's no latency to report to the host.  It is off
+        by default; the plugins leave it to the user and don't offer it
+        for automation.
+
+        Re-slices and clears the delay lines, cutting off the tail.  The
+        arena is always reserved for the full rate, so up to maxSampleRate
+        this doesn't allocate and can be called from the audio thread. */
+    void setReducedInternalRate (const bool shouldReduce) {
+        if (shouldReduce == reduceRate)
+            return;
+
+        reduceRate = shouldReduce;
+        setSampleRate (currentSampleRate);
+    }
+
+    bool hasReducedInternalRate() const noexcept { return reduceRate; }
+
+    /** Stores the comb and allpass delay lines as IEEE half floats, which
+        halves the memory they take and the bandwidth it costs to stream
+        them.  Each comb's filter state and all of the arithmetic stay in
+        single precision: only the samples sitting in the lines are rounded,
+        to 11 significant bits, which leaves the difference from float lines
+        about 75 dB below the output.
+
+        Storage is float or half whatever the I/O sample type.  There is no
+        double storage: the network computes in single precision even for
+        double I/O, so float lines already hold every bit it produces.
+
+        It pays off when many instances' lines together no longer fit in the
+        caches; with them in cache the conversions make processing 10 to 20
+        percent slower.  Block processing converts a vector at a time on
+        CPUs with F16C (the AVX2 and AVX-512 kernels) and on AArch64, and one
+        sample at a time in software elsewhere, which costs several times
+        what it saves.
+
+        Reallocates and clears the delay lines, so it is not real-time
+        safe. */
+    void setCompactStorage (const bool shouldBeCompact) {
+        if (shouldBeCompact == compact)
+            return;
+
+        compact = shouldBeCompact;
+        arena.release();
+        reserveArena();
+        setSampleRate (currentSampleRate);
+    }
 
+    bool hasCompactStorage() const noexcept { return compact; }
+
+    /** Returns the rate the comb and allpass network runs at. */
+    double getInternalSampleRate() const noexcept { return currentSampleRate / rateFactor; }
+
+    /** Lays the delay lines out for a sample rate and clears them.  Up to
+        maxSampleRate this only re-slices the arena reserved when the
+        reverb was created, so a host can reactivate the plugin, at the
+        same rate or another, without any allocation; only higher rates
+        grow it.  Clears the lines and filters, so there's no need to call
+        reset() as well. */
+    void setSampleRate (const double sampleRate) {
+        currentSampleRate       = sampleRate;
+        rateFactor              = rateFactorFor (sampleRate, reduceRate);
+        const int intSampleRate = (int) (sampleRate / rateFactor);
+        arena.reserve (arenaSize (intSampleRate, numLines, compact));
+
+        // comb j's left and right lines sit next to each other, followed
+        // by the allpass pairs, each line starting on its own cache line.
+        // A mono instance points its right lines at the left ones.
+        float* data = arena.get();
         for (int i = 0; i < numCombs; ++i) {
-            comb[0][i].setSize ((intSampleRate * combTunings[i]) / 44100);
-            comb[1][i].setSize ((intSampleRate * (combTunings[i] + stereoSpread)) / 44100);
+            float* const left = data;
+            for (int c = 0; c < numLines; ++c) {
+                const int size = combLength (c, i, intSampleRate);
+                setCombLine (c, i, data, size);
+                data += lineFloats (size, compact);
+            }
+            if (numLines == 1)
+                setCombLine (1, i, left, combLength (0, i, intSampleRate));
         }
 
         for (int i = 0; i < numAllPasses; ++i) {
-            allPass[0][i].setSize ((intSampleRate * allPassTunings[i]) / 44100);
-            allPass[1][i].setSize ((intSampleRate * (allPassTunings[i] + stereoSpread)) / 44100);
+            for (int c = 0; c < numLines; ++c) {
+                const int size = allPassLength (c, i, intSampleRate);
+                if (compact)
+                    allPass[c][i].setBuffer (reinterpret_cast<roboverb::kernels::Half*> (data), size);
+                else
+                    allPass[c][i].setBuffer (data, size);
+                data += lineFloats (size, compact);
+            }
+            if (numLines == 1)
+                allPass[1][i] = allPass[0][i];
         }
 
+        // the comb coefficients move at the network's rate, the gains at
+        // the host's
         const double smoothTime = 0.01;
-        damping.reset (sampleRate, smoothTime);
-        feedback.reset (sampleRate, smoothTime);
+        damping.reset (sampleRate / rateFactor, smoothTime);
+        feedback.reset (sampleRate / rateFactor, smoothTime);
         dryGain.reset (sampleRate, smoothTime);
         wetGain1.reset (sampleRate, smoothTime);
         wetGain2.reset (sampleRate, smoothTime);
+
+        decimator.setFactor (rateFactor);
+        interpolator.setFactor (rateFactor);
+
+        updateTailSpan();
+        sleeping = true;
     }
 
-    /** Clears the reverb's buffers. */
-    void reset() {
-        for (int j = 0; j < numChannels; ++j) {
+    /** Clears the reverb's buffers.  Takes constant time, so it is safe on
+        the audio thread: the delay lines are only rewound, and processing
+        zeroes each stretch of them just before it first reads it again (see
+        CombBank), which sounds exactly like clearing them here. */
+    void reset() noexcept {
+        for (int j = 0; j < numLines; ++j) {
             for (int i = 0; i < numCombs; ++i)
-                comb[j][i].clear();
+                combs.clearLazily (j, i);
 
             for (int i = 0; i < numAllPasses; ++i)
-                allPass[j][i].clear();
+                allPass[j][i].clearLazily();
         }
+
+        decimator.clear();
+        interpolator.clear();
+
+        sleeping = true;
+    }
+
+    /** Returns the number of bytes of delay line the current layout uses,
+        for the network's rate, channels and storage. */
+    size_t getMemorySize() const noexcept {
+        return arenaSize ((int) (currentSampleRate / rateFactor), numLines, compact) * sizeof (float);
+    }
+
+    /** Returns the number of bytes of delay-line memory this instance has
+        reserved, which covers the network at full rate up to maxSampleRate
+        whatever the current layout uses. */
+    size_t getReservedMemorySize() const noexcept { return arena.size() * sizeof (float); }
+
+    /** Peak level, about -120 dBFS, below which input counts as silent and
+        the tail counts as decayed. */
+    static constexpr float silenceThreshold = 1.0e-6f;
+
+    /** Returns true while the comb/allpass network is bypassed because the
+        input is silent and the tail has decayed below silenceThreshold.
+        Any non-silent input wakes the network up again. */
+    bool isSleeping() const noexcept { return sleeping; }
+
+    /** Advances over numSamples of silent input without touching any
+        buffers.  Only does anything while sleeping; returns false if the
+        network is awake and the block has to be processed. */
+    bool skipSilence (const int numSamples) noexcept {
+        if (! sleeping)
+            return false;
+        skipSmoothing (numSamples);
+        return true;
+    }
+
+    /** Returns the number of samples it takes for the tail to decay below
+        silenceThreshold with the current room size and enabled filters, or
+        -1 if the reverb is frozen and the tail never ends. */
+    int getTailLength() const noexcept;
+
+    /** Selects between filter-major block processing (the default) and
+        sample-major processing of the whole network. */
+    void setBlockProcessing (const bool shouldProcessBlocks) noexcept {
+        blockProcessing = shouldProcessBlocks;
     }
 
+    bool isBlockProcessing() const noexcept { return blockProcessing; }
+
+    /** Replaces the block processing kernels picked for this CPU when the
+        reverb was created, e.g. with roboverb::kernels::reference(). */
+    void setKernels (const roboverb::kernels::Kernels& newKernels) noexcept { kernels = &newKernels; }
+
+    /** Returns the name of the kernels block processing runs on. */
+    const char* getKernelName() const noexcept { return kernels->name; }
+
+    /** Runs tasks 0 to numTasks - 1, possibly concurrently, by calling
+        runTask() for each, and returns once all of them are done.  Returns
+        false without running any if it cannot, e.g. when the host declines. */
+    using TaskRunner = bool (*) (void* context, int numTasks);
+
+    /** Lets block processing render the left and right networks as two
+        concurrent tasks for calls of at least minBlockSize frames; shorter
+        calls are not worth the synchronisation.  The output is identical
+        to serial processing at full rate; at a reduced internal rate the
+        network runs over longer blocks than it does serially, which only
+        moves the rounding.  Allocates the shared block memory the first
+        time, so call it from a non-realtime thread; pass nullptr to go back
+        to serial.  The memory is kept for the next runner, so hosts that
+        offer a thread pool on some activations and not others don't cause
+        an allocation each time. */
+    void setTaskRunner (TaskRunner runner, void* context, int minBlockSize = 512);
+
+    /** Renders one channel of the block being processed in parallel.  Only
+        called by the task runner, for tasks 0 and 1. */
+    void runTask (const int task) noexcept { (this->*renderers.channel) (task); }
+
+    /** Applies the reverb to two channels of audio data.  Only valid for an
+        instance created with the Stereo layout.  out1 and out2 may be the
+        same buffers as left and right. */
     void processStereo (float* const left, float* const right,
                         float* const out1, float* const out2,
                         const int numSamples) noexcept {
         // jassert (left != nullptr && right != nullptr);
+        const bool inputSilent = isSilent (left, numSamples) && isSilent (right, numSamples);
+        if (inputSilent && skipSilence (numSamples)) {
+            std::fill_n (out1, numSamples, 0.0f);
+            std::fill_n (out2, numSamples, 0.0f);
+            return;
+        }
 
-        for (int i = 0; i < numSamples; ++i) {
-            const float input = (left[i] + right[i]) * gain;
-            float outL = 0, outR = 0;
+        if (rateFactor > 1) {
+            renderReduced (left, right, out1, out2, numSamples);
+        } else if (blockProcessing && taskRunner != nullptr && numSamples >= parallelMinBlockSize) {
+            renderParallel (left, right, out1, out2, numSamples);
+        } else if (blockProcessing) {
+            for (int pos = 0; pos < numSamples; pos += maxBlockSize) {
+                const int len = std::min (numSamples - pos, (int) maxBlockSize);
+                (this->*renderers.block) (left + pos, right + pos, out1 + pos, out2 + pos, len);
+            }
+        } else {
+            (this->*renderers.samples) (left, right, out1, out2, numSamples);
+        }
 
-            const float damp    = damping.getNextValue();
-            const float feedbck = feedback.getNextValue();
+        trackTail (inputSilent, inputSilent && isSilent (out1, numSamples) && isSilent (out2, numSamples), numSamples);
+    }
 
-            for (int j = 0; j < numCombs; ++j) // accumulate the comb filters in parallel
-            {
-                if (! enabledCombs[j])
-                    continue;
-                outL += comb[0][j].process (input, damp, feedbck);
-                outR += comb[1][j].process (input, damp, feedbck);
-            }
+    /** Double precision version of processStereo().  The delay network
+        still runs and stores its lines in single precision, so this takes
+        no more memory, but the dry signal and the wet/dry mix keep full
+        precision.  Always uses block processing. */
+    void processStereo (const double* left, const double* right,
+                        double* out1, double* out2,
+                        int numSamples) noexcept;
+
+    /** Applies the reverb to a single mono channel of float or double audio
+        data, running only the left comb and allpass network. */
+    template <typename Sample>
+    void processMono (Sample* const samples, const int numSamples) noexcept {
+        // jassert (samples != nullptr);
+        const bool inputSilent = isSilent (samples, numSamples);
+        if (inputSilent && skipSilence (numSamples)) {
+            std::fill_n (samples, numSamples, Sample (0));
+            return;
+        }
 
-            for (int j = 0; j < numAllPasses; ++j) // run the allpass filters in series
-            {
-                if (! enabledAllPasses[j])
-                    continue;
-                outL = allPass[0][j].process (outL);
-                outR = allPass[1][j].process (outR);
-            }
+        if (rateFactor > 1)
+            renderReducedMono (samples, numSamples);
+        else if (blockProcessing)
+            renderMonoBlock (samples, numSamples);
+        else
+            runMono (samples, numSamples);
+        trackTail (inputSilent, inputSilent && isSilent (samples, numSamples), numSamples);
+    }
 
-            const float dry  = dryGain.getNextValue();
-            const float wet1 = wetGain1.getNextValue();
-            const float wet2 = wetGain2.getNextValue();
+private:
+    friend class RoboverbBank;
+
+    /** Number of frames rendered per pass when block processing. */
+    enum { maxBlockSize = 256 };
+
+    enum { numCombs     = 8,
+           numAllPasses = 4,
+           numChannels  = 2,
+           stereoSpread = 23 };
+
+    /** A single cache-line aligned block of memory that every delay line of
+        an instance is carved from.  Reserved for maxSampleRate when the
+        reverb is created, so changing the rate only re-slices it. */
+    class Arena {
+    public:
+        enum { lineFloats = roboverb::simd::alignment / sizeof (float) };
+
+        /** Rounds a delay length up to a whole number of cache lines. */
+        static size_t padded (const int size) noexcept {
+            return ((size_t) size + lineFloats - 1) / lineFloats * lineFloats;
+        }
+
+        /** Makes room for at least numFloats.  Existing contents are lost
+            if the arena has to grow. */
+        void reserve (const size_t numFloats) {
+            if (numFloats <= capacity)
+                return;
+
+            storage.reset (new float[numFloats + lineFloats]);
+            const auto address = reinterpret_cast<std::uintptr_t> (storage.get());
+            const auto aligned = (address + roboverb::simd::alignment - 1) & ~(std::uintptr_t) (roboverb::simd::alignment - 1);
+            data               = reinterpret_cast<float*> (aligned);
+            capacity           = numFloats;
+        }
 
-            out1[i] = outL * wet1 + outR * wet2 + left[i] * dry;
-            out2[i] = outR * wet1 + outL * wet2 + right[i] * dry;
+        /** Frees the memory. */
+        void release() noexcept {
+            storage.reset();
+            data     = nullptr;
+            capacity = 0;
         }
+
+        float* get() const noexcept { return data; }
+        size_t size() const noexcept { return capacity; }
+
+    private:
+        std::unique_ptr<float[]> storage;
+        float* data     = nullptr;
+        size_t capacity = 0;
+    };
+
+    static bool isFrozen (const float freezeMode) noexcept { return freezeMode >= 0.5f; }
+
+    static int combLength (const int channel, const int comb, const int sampleRate) noexcept {
+        //static const short combTunings[] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 }; // (at 44100Hz)
+        static const short combTunings[] = { 8092, 4096, 2048, 1024, 512, 256, 128, 64 }; // (at 44100Hz)
+        return (int) (((int64_t) sampleRate * (combTunings[comb] + channel * stereoSpread)) / 44100);
     }
 
-    /** Applies the reverb to a single mono channel of audio data. */
-    void processMono (float* const samples, const int numSamples) noexcept {
-        // jassert (samples != nullptr);
+    static int allPassLength (const int channel, const int allPass, const int sampleRate) noexcept {
+        static const short allPassTunings[] = { 556, 441, 341, 225 };
+        return (int) (((int64_t) sampleRate * (allPassTunings[allPass] + channel * stereoSpread)) / 44100);
+    }
 
-        for (int i = 0; i < numSamples; ++i) {
-            const float input = samples[i] * gain;
-            float output      = 0;
+    /** Returns how many times lower than the host's rate the network runs. */
+    static int rateFactorFor (const double sampleRate, const bool reduce) noexcept {
+        int factor = 1;
+        while (reduce && factor < 4 && sampleRate / factor >= 88200.0)
+            factor *= 2;
+        return factor;
+    }
 
-            const float damp    = damping.getNextValue();
-            const float feedbck = feedback.getNextValue();
+    /** Reserves the arena for the network at full rate at any host rate up
+        to maxSampleRate, which also covers every reduced rate, so turning
+        setReducedInternalRate() on or off never has to allocate. */
+    void reserveArena() { arena.reserve (arenaSize ((int) maxSampleRate, numLines, compact)); }
 
-            for (int j = 0; j < numCombs; ++j) {
-                // accumulate the comb filters in parallel
-                if (! enabledCombs[j])
-                    continue;
-                output += comb[0][j].process (input, damp, feedbck);
-            }
+    /** Returns the floats of arena a delay line of `size` samples takes. */
+    static size_t lineFloats (const int size, const bool halfFloats) noexcept {
+        return Arena::padded (halfFloats ? (size + 1) / 2 : size);
+    }
 
-            for (int j = 0; j < numAllPasses; ++j) {
-                // run the allpass filters in series
-                if (! enabledAllPasses[j])
-                    continue;
-                output = allPass[0][j].process (output);
-            }
+    /** Returns the number of floats the arena needs for the delay lines of
+        `channels` networks at a sample rate. */
+    static size_t arenaSize (const int sampleRate, const int channels, const bool halfFloats) noexcept {
+        size_t total = 0;
+        for (int c = 0; c < channels; ++c) {
+            for (int i = 0; i < numCombs; ++i)
+                total += lineFloats (combLength (c, i, sampleRate), halfFloats);
+            for (int i = 0; i < numAllPasses; ++i)
+                total += lineFloats (allPassLength (c, i, sampleRate), halfFloats);
+        }
+        return total;
+    }
+
+    /** Points a comb line at arena memory, as half floats in compact mode. */
+    void setCombLine (const int channel, const int comb, float* const data, const int size) noexcept {
+        if (compact)
+            combs.setBuffer (channel, comb, reinterpret_cast<roboverb::kernels::Half*> (data), size);
+        else
+            combs.setBuffer (channel, comb, data, size);
+    }
 
-            const float dry  = dryGain.getNextValue();
-            const float wet1 = wetGain1.getNextValue();
+    template <typename Sample>
+    static bool isSilent (const Sample* const samples, const int numSamples) noexcept {
+        Sample peak = 0;
+        for (int i = 0; i < numSamples; ++i)
+            peak = std::max (peak, std::abs (samples[i]));
+        return peak <= silenceThreshold;
+    }
 
-            samples[i] = output * wet1 + samples[i] * dry;
+    /** Counts consecutive samples of silent input that produced silent
+        output.  Once that run covers the longest path through the live
+        delay lines, nothing audible is left circulating and the network is
+        put to sleep. */
+    void trackTail (const bool inputSilent, const bool outputSilent, const int numSamples) noexcept {
+        if (! inputSilent) {
+            sleeping     = false;
+            quietSamples = 0;
+            return;
         }
+
+        quietSamples = outputSilent ? quietSamples + numSamples : 0;
+        sleeping     = quietSamples >= tailSpan;
     }
 
-private:
-    static bool isFrozen (const float freezeMode) noexcept { return freezeMode >= 0.5f; }
+    void skipSmoothing (const int numSamples) noexcept {
+        damping.skip (numSamples / rateFactor);
+        feedback.skip (numSamples / rateFactor);
+        dryGain.skip (numSamples);
+        wetGain1.skip (numSamples);
+        wetGain2.skip (numSamples);
+    }
 
-    void updateDamping() noexcept {
-        const float roomScaleFactor = 0.28f;
-        const float roomOffset      = 0.7f;
-        const float dampScaleFactor = 0.4f;
+    void updateTailSpan() noexcept;
 
-        if (isFrozen (parameters.freezeMode))
-            setDamping (0.0f, 1.0f);
-        else
-            setDamping (parameters.damping * dampScaleFactor,
-                        parameters.roomSize * roomScaleFactor + roomOffset);
+    /** The gains and filter coefficients a set of parameters maps to. */
+    struct Targets {
+        Targets() noexcept = default;
+
+        explicit Targets (const Parameters& params) noexcept {
+            levels (params);
+            room (params);
+        }
+
+        /** Computes the output gains from the wet, dry and width levels. */
+        void levels (const Parameters& params) noexcept {
+            const float wetScaleFactor = 6.0f;
+            const float dryScaleFactor = 2.0f;
+
+            const float wet = params.wetLevel * wetScaleFactor;
+            dry             = params.dryLevel * dryScaleFactor;
+            wet1            = 0.5f * wet * (1.0f + params.width);
+            wet2            = 0.5f * wet * (1.0f - params.width);
+        }
+
+        /** Computes the input gain and comb coefficients from the room size,
+            damping and freeze mode. */
+        void room (const Parameters& params) noexcept {
+            const float roomScaleFactor = 0.28f;
+            const float roomOffset      = 0.7f;
+            const float dampScaleFactor = 0.4f;
+
+            const bool frozen = isFrozen (params.freezeMode);
+            gain              = frozen ? 0.0f : 0.015f;
+            damping           = frozen ? 0.0f : params.damping * dampScaleFactor;
+            feedback          = frozen ? 1.0f : params.roomSize * roomScaleFactor + roomOffset;
+        }
+
+        float dry = 0, wet1 = 0, wet2 = 0, gain = 0, damping = 0, feedback = 0;
+    };
+
+    void applyLevels() noexcept {
+        Targets targets;
+        targets.levels (parameters);
+        dryGain.setValue (targets.dry);
+        wetGain1.setValue (targets.wet1);
+        wetGain2.setValue (targets.wet2);
     }
 
-    void setDamping (const float dampingToUse, const float roomSizeToUse) noexcept {
-        damping.setValue (dampingToUse);
-        feedback.setValue (roomSizeToUse);
+    void applyRoom() noexcept {
+        Targets targets;
+        targets.room (parameters);
+        damping.setValue (targets.damping);
+        feedback.setValue (targets.feedback);
+        gain = targets.gain;
     }
 
-    class CombFilter {
+    /** The comb filters of both channels in structure-of-arrays form.
+
+        Each comb owns two adjacent entries, left then right.  Enabled combs
+        are packed to the front in ascending order, so with `n` combs enabled
+        entries [0, 2n) are exactly the live delay lines and nothing has to
+        test an enable flag while processing.  Toggling a comb re-packs the
+        entries; only pointers into the arena move, never samples.
+
+        The sample-major paths read and write the delay lines per entry.
+        processStereo() does the damping and feedback arithmetic for all
+        live entries a vector at a time, with the same operations in the
+        same order as process(), so the two agree exactly.  The block calls
+        instead hand one or two whole lines to a comb kernel, which runs the
+        damping recursion along time and fuses multiply-adds where the CPU
+        has FMA.  That rounds differently, so block and sample-major output
+        agree only to within rounding error.
+
+        In compact mode the lines hold half floats: each entry's halfBuffers
+        pointer is set instead of its buffers one, and the block calls take
+        the half float kernels.
+
+        clearLazily() only rewinds a line.  Each entry keeps a watermark,
+        `cleared`, below which its samples are either zero or were written
+        since; the block calls zero the stale samples they are about to read
+        just before reading them, so the work of clearing is spread over the
+        blocks that follow a reset and the output is the same as after a
+        memset.  The sample-major renderers call clearAhead() for that.
+    */
+    class CombBank {
     public:
-        CombFilter() noexcept : bufferSize (0), bufferIndex (0), last (0) {}
+        enum { numEntries = numChannels * numCombs };
+
+        CombBank() noexcept {
+            for (int e = 0; e < numEntries; ++e) {
+                buffers[e]     = nullptr;
+                halfBuffers[e] = nullptr;
+                bufferSize[e]  = bufferIndex[e] = cleared[e] = 0;
+                last[e] = idleLast[e] = output[e] = temp[e] = 0;
+            }
 
-        void setSize (const int size) {
-            if (size != bufferSize) {
-                bufferIndex = 0;
-                buffer.reset (new float[size]);
-                bufferSize = size;
+            for (int j = 0; j < numCombs; ++j) {
+                enabled[j] = false;
+                slot[j]    = j;
             }
 
-            clear();
+            numActive = 0;
         }
 
-        void clear() noexcept {
-            last = 0;
-            memset (buffer.get(), 0, sizeof (float) * (size_t) bufferSize);
+        /** Returns the entry that holds a channel of a comb. */
+        int entry (const int channel, const int comb) const noexcept { return 2 * slot[comb] + channel; }
+
+        /** Returns the number of enabled combs. */
+        int getNumActive() const noexcept { return numActive; }
+
+        /** Returns the delay line length of an entry in samples. */
+        int getSize (const int e) const noexcept { return bufferSize[e]; }
+
+        /** Points a comb's delay line at `size` floats of arena memory and
+            clears it. */
+        void setBuffer (const int channel, const int comb, float* const data, const int size) noexcept {
+            const int e    = entry (channel, comb);
+            buffers[e]     = data;
+            halfBuffers[e] = nullptr;
+            bufferSize[e]  = size;
+            bufferIndex[e] = 0;
+            clear (channel, comb);
+        }
+
+        /** Points a comb's delay line at `size` half floats and clears it. */
+        void setBuffer (const int channel, const int comb, roboverb::kernels::Half* const data, const int size) noexcept {
+            const int e    = entry (channel, comb);
+            buffers[e]     = nullptr;
+            halfBuffers[e] = data;
+            bufferSize[e]  = size;
+            bufferIndex[e] = 0;
+            clear (channel, comb);
         }
 
-        float process (const float input, const float damp, const float feedbackLevel) noexcept {
-            const float output = buffer[bufferIndex];
-            last               = (output * (1.0f - damp)) + (last * damp);
+        void clear (const int channel, const int comb) noexcept {
+            const int e = entry (channel, comb);
+            last[e] = idleLast[e] = 0;
+            zero (e, 0, bufferSize[e]);
+            cleared[e] = bufferSize[e];
+        }
+
+        /** Clears a comb in constant time by rewinding its delay line; the
+            samples are zeroed as processing reaches them. */
+        void clearLazily (const int channel, const int comb) noexcept {
+            const int e = entry (channel, comb);
+            last[e] = idleLast[e] = 0;
+            bufferIndex[e] = cleared[e] = 0;
+        }
+
+        /** Zeroes whatever clearLazily() left stale among the next numSamples
+            samples an entry will read. */
+        void clearAhead (const int e, const int numSamples) noexcept {
+            const int end = std::min (bufferSize[e], bufferIndex[e] + numSamples);
+            if (end > cleared[e]) {
+                zero (e, cleared[e], end);
+                cleared[e] = end;
+            }
+        }
+
+        /** Turns comb `index` on or off for both channels and re-packs the
+            entries.  A disabled comb keeps its delay line and state. */
+        void setEnabled (const int index, const bool isOn) noexcept {
+            if (enabled[index] == isOn)
+                return;
+
+            struct Line {
+                float* buffer;
+                roboverb::kernels::Half* halfBuffer;
+                int size, index, cleared;
+                float last;
+            } lines[numEntries];
+
+            for (int j = 0; j < numCombs; ++j) {
+                for (int c = 0; c < numChannels; ++c) {
+                    const int e = entry (c, j);
+                    auto& line  = lines[c * numCombs + j];
+                    line.buffer     = buffers[e];
+                    line.halfBuffer = halfBuffers[e];
+                    line.size       = bufferSize[e];
+                    line.index      = bufferIndex[e];
+                    line.cleared    = cleared[e];
+                    line.last       = enabled[j] ? last[e] : idleLast[e];
+                }
+            }
+
+            enabled[index] = isOn;
+
+            int next = 0;
+            for (int j = 0; j < numCombs; ++j)
+                if (enabled[j])
+                    slot[j] = next++;
+            numActive = next;
+            for (int j = 0; j < numCombs; ++j)
+                if (! enabled[j])
+                    slot[j] = next++;
+
+            for (int j = 0; j < numCombs; ++j) {
+                for (int c = 0; c < numChannels; ++c) {
+                    const int e    = entry (c, j);
+                    auto& line     = lines[c * numCombs + j];
+                    buffers[e]     = line.buffer;
+                    halfBuffers[e] = line.halfBuffer;
+                    bufferSize[e]  = line.size;
+                    bufferIndex[e] = line.index;
+                    cleared[e]     = line.cleared;
+                    (enabled[j] ? last[e] : idleLast[e]) = line.last;
+                }
+            }
+        }
+
+        /** Scalar reference: runs one sample through a single entry. */
+        float process (const int e, const float input, const float damp, const float feedbackLevel) noexcept {
+            int& index = bufferIndex[e];
+
+            const float output = read (e);
+            last[e]            = (output * (1.0f - damp)) + (last[e] * damp);
             // JUCE_UNDENORMALISE (last);
 
-            float temp = input + (last * feedbackLevel);
+            float temp = input + (last[e] * feedbackLevel);
             // JUCE_UNDENORMALISE (temp);
-            buffer[bufferIndex] = temp;
-            bufferIndex         = (bufferIndex + 1) % bufferSize;
+            write (e, temp);
+            if (++index == bufferSize[e])
+                index = 0;
             return output;
         }
 
+        /** Runs a block through both channels of the k'th enabled comb with
+            one of the comb kernels, adding the outputs to `outL` and `outR`.
+            halfKernel is the same kernel for half float lines. */
+        void processBlock (const roboverb::kernels::CombKernel kernel,
+                           const roboverb::kernels::CombKernelFor<roboverb::kernels::Half> halfKernel, const int k,
+                           const float* input, const float* damp, const float* feedbackLevel,
+                           float* outL, float* outR, const int numSamples) noexcept {
+            const int eL = 2 * k;
+            clearAhead (eL, numSamples);
+            clearAhead (eL + 1, numSamples);
+            if (halfBuffers[eL] != nullptr)
+                halfKernel (halfBuffers + eL, bufferSize + eL, bufferIndex + eL, last + eL,
+                            input, damp, feedbackLevel, outL, outR, numSamples);
+            else
+                kernel (buffers + eL, bufferSize + eL, bufferIndex + eL, last + eL,
+                        input, damp, feedbackLevel, outL, outR, numSamples);
+        }
+
+        /** Runs a block through one channel of enabled combs k to
+            k + numLines - 1 (one or two of them), adding the outputs in that
+            order to `out`.  Touches no state of the other channel. */
+        void processChannelBlock (const roboverb::kernels::CombKernel kernel,
+                                  const roboverb::kernels::CombKernelFor<roboverb::kernels::Half> halfKernel,
+                                  const int channel, const int k, const int numLines,
+                                  const float* input, const float* damp, const float* feedbackLevel,
+                                  float* out, const int numSamples) noexcept {
+            if (halfBuffers[2 * k + channel] != nullptr)
+                processLines (halfKernel, halfBuffers, channel, k, numLines, input, damp, feedbackLevel, out, numSamples);
+            else
+                processLines (kernel, buffers, channel, k, numLines, input, damp, feedbackLevel, out, numSamples);
+        }
+
+        /** Runs one sample through the first NumActive combs of both
+            channels and adds the results to outL and outR. */
+        template <class Vec, int NumActive>
+        void processStereo (const float input, const float damp, const float feedbackLevel,
+                            float& outL, float& outR) noexcept {
+            for (int e = 0; e < 2 * NumActive; e += 2) {
+                output[e]     = read (e);
+                output[e + 1] = read (e + 1);
+                outL += output[e];
+                outR += output[e + 1];
+            }
+
+            const Vec in = Vec::broadcast (input);
+            const Vec d  = Vec::broadcast (damp);
+            const Vec d1 = Vec::broadcast (1.0f - damp);
+            const Vec fb = Vec::broadcast (feedbackLevel);
+
+            // entries past the live ones only ever hold scratch values
+            for (int e = 0; e < 2 * NumActive; e += Vec::width) {
+                const Vec next = (Vec::load (output + e) * d1) + (Vec::load (last + e) * d);
+                next.store (last + e);
+                (in + (next * fb)).store (temp + e);
+            }
+
+            for (int e = 0; e < 2 * NumActive; ++e) {
+                write (e, temp[e]);
+                if (++bufferIndex[e] == bufferSize[e])
+                    bufferIndex[e] = 0;
+            }
+        }
+
     private:
-        std::unique_ptr<float[]> buffer;
-        int bufferSize, bufferIndex;
-        float last;
+        /** Zeroes samples [from, to) of an entry's delay line. */
+        void zero (const int e, const int from, const int to) noexcept {
+            if (halfBuffers[e] != nullptr)
+                memset (halfBuffers[e] + from, 0, sizeof (roboverb::kernels::Half) * (size_t) (to - from));
+            else
+                memset (buffers[e] + from, 0, sizeof (float) * (size_t) (to - from));
+        }
+
+        /** Returns the sample at an entry's read position. */
+        float read (const int e) const noexcept {
+            return halfBuffers[e] != nullptr ? roboverb::simd::fromHalf (halfBuffers[e][bufferIndex[e]])
+                                             : buffers[e][bufferIndex[e]];
+        }
+
+        /** Replaces the sample at an entry's read position. */
+        void write (const int e, const float value) noexcept {
+            if (halfBuffers[e] != nullptr)
+                halfBuffers[e][bufferIndex[e]] = roboverb::simd::toHalf (value);
+            else
+                buffers[e][bufferIndex[e]] = value;
+        }
+
+        template <typename Storage>
+        void processLines (const roboverb::kernels::CombKernelFor<Storage> kernel, Storage* const* const lines,
+                           const int channel, const int k, const int numLines,
+                           const float* input, const float* damp, const float* feedbackLevel,
+                           float* out, const int numSamples) noexcept {
+            Storage* lineBuffers[2] {};
+            int lineSizes[2] {}, lineIndices[2] {};
+            float lineLast[2] {};
+            for (int j = 0; j < numLines; ++j) {
+                const int e = 2 * (k + j) + channel;
+                clearAhead (e, numSamples);
+                lineBuffers[j] = lines[e];
+                lineSizes[j]   = bufferSize[e];
+                lineIndices[j] = bufferIndex[e];
+                lineLast[j]    = last[e];
+            }
+
+            kernel (lineBuffers, lineSizes, lineIndices, lineLast,
+                    input, damp, feedbackLevel, out, out, numSamples);
+
+            for (int j = 0; j < numLines; ++j) {
+                const int e    = 2 * (k + j) + channel;
+                bufferIndex[e] = lineIndices[j];
+                last[e]        = lineLast[j];
+            }
+        }
+
+        alignas (roboverb::simd::alignment) float last[numEntries];
+        alignas (roboverb::simd::alignment) float output[numEntries];
+        alignas (roboverb::simd::alignment) float temp[numEntries];
+        float idleLast[numEntries];
+        float* buffers[numEntries];
+        roboverb::kernels::Half* halfBuffers[numEntries];
+        int bufferSize[numEntries], bufferIndex[numEntries], cleared[numEntries];
+        bool enabled[numCombs];
+        int slot[numCombs], numActive;
     };
 
     //==============================================================================
     class AllPassFilter {
     public:
-        AllPassFilter() noexcept : bufferSize (0), bufferIndex (0) {}
-
-        void setSize (const int size) {
-            if (size != bufferSize) {
-                bufferIndex = 0;
-                buffer.reset (new float[size]);
-                bufferSize = size;
-            }
+        AllPassFilter() noexcept : buffer (nullptr), halfBuffer (nullptr), bufferSize (0), bufferIndex (0), cleared (0) {}
+
+        /** Points the delay line at `size` floats of arena memory and clears it. */
+        void setBuffer (float* const data, const int size) noexcept {
+            buffer      = data;
+            halfBuffer  = nullptr;
+            bufferSize  = size;
+            bufferIndex = 0;
+            clear();
+        }
 
+        /** Points the delay line at `size` half floats and clears it. */
+        void setBuffer (roboverb::kernels::Half* const data, const int size) noexcept {
+            buffer      = nullptr;
+            halfBuffer  = data;
+            bufferSize  = size;
+            bufferIndex = 0;
             clear();
         }
 
         void clear() noexcept {
-            memset (buffer.get(), 0, sizeof (float) * (size_t) bufferSize);
+            zero (0, bufferSize);
+            cleared = bufferSize;
         }
 
+        /** Clears the filter in constant time, the same way as
+            CombBank::clearLazily(). */
+        void clearLazily() noexcept { bufferIndex = cleared = 0; }
+
+        /** Zeroes whatever clearLazily() left stale among the next numSamples
+            samples the filter will read. */
+        void clearAhead (const int numSamples) noexcept {
+            const int end = std::min (bufferSize, bufferIndex + numSamples);
+            if (end > cleared) {
+                zero (cleared, end);
+                cleared = end;
+            }
+        }
+
+        int getSize() const noexcept { return bufferSize; }
+
         float process (const float input) noexcept {
-            const float bufferedValue = buffer[bufferIndex];
+            const float bufferedValue = halfBuffer != nullptr ? roboverb::simd::fromHalf (halfBuffer[bufferIndex])
+                                                              : buffer[bufferIndex];
             float temp                = input + (bufferedValue * 0.5f);
             // JUCE_UNDENORMALISE (temp);
-            buffer[bufferIndex] = temp;
-            bufferIndex         = (bufferIndex + 1) % bufferSize;
+            if (halfBuffer != nullptr)
+                halfBuffer[bufferIndex] = roboverb::simd::toHalf (temp);
+            else
+                buffer[bufferIndex] = temp;
+            bufferIndex = (bufferIndex + 1) % bufferSize;
             return bufferedValue - input;
         }
 
+        /** Runs a block through the filter in place with an allpass kernel,
+            or with halfKernel if the line holds half floats. */
+        void processBlock (const roboverb::kernels::AllPassKernel kernel,
+                           const roboverb::kernels::AllPassKernelFor<roboverb::kernels::Half> halfKernel,
+                           float* const samples, const int numSamples) noexcept {
+            clearAhead (numSamples);
+            if (halfBuffer != nullptr)
+                halfKernel (halfBuffer, bufferSize, &bufferIndex, samples, numSamples);
+            else
+                kernel (buffer, bufferSize, &bufferIndex, samples, numSamples);
+        }
+
     private:
-        std::unique_ptr<float[]> buffer;
-        int bufferSize, bufferIndex;
+        void zero (const int from, const int to) noexcept {
+            if (halfBuffer != nullptr)
+                memset (halfBuffer + from, 0, sizeof (roboverb::kernels::Half) * (size_t) (to - from));
+            else
+                memset (buffer + from, 0, sizeof (float) * (size_t) (to - from));
+        }
+
+        float* buffer;
+        roboverb::kernels::Half* halfBuffer;
+        int bufferSize, bufferIndex, cleared;
     };
 
     class LinearSmoothedValue {
@@ -365,23 +1062,173 @@ private:
             return currentValue;
         }
 
+        float getTargetValue() const noexcept { return target; }
+
+        /** Returns true while the value is still ramping to its target.
+            Once settled every call to getNextValue() returns the target. */
+        bool isSmoothing() const noexcept { return countdown > 0; }
+
+        /** Writes the next numSamples values to every stride'th element of
+            dest, exactly as that many calls to getNextValue() would return
+            them. */
+        void render (float* const dest, const int numSamples, const int stride = 1) noexcept {
+            const int ramp = std::max (0, std::min (countdown, numSamples));
+            int i          = 0;
+            for (; i < ramp; ++i) {
+                currentValue += step;
+                dest[i * stride] = currentValue;
+            }
+
+            countdown -= ramp;
+            for (; i < numSamples; ++i)
+                dest[i * stride] = target;
+        }
+
+        /** Advances the ramp as if getNextValue() was called numSamples times. */
+        void skip (const int numSamples) noexcept {
+            if (countdown <= numSamples) {
+                countdown    = 0;
+                currentValue = target;
+                return;
+            }
+
+            countdown -= numSamples;
+            currentValue += step * (float) numSamples;
+        }
+
     private:
         float currentValue, target, step;
         int countdown, stepsToTarget;
     };
 
+    using StereoRenderer = void (Roboverb::*) (const float*, const float*, float*, float*, int) noexcept;
+    using WetRenderer    = void (Roboverb::*) (const float*, const float*, int) noexcept;
+    using MonoWetRenderer = void (Roboverb::*) (const float*, int) noexcept;
+    using ChannelRenderer = void (Roboverb::*) (int) noexcept;
+    template <typename Sample>
+    using MonoRenderer = void (Roboverb::*) (Sample*, int) noexcept;
+
+    /** Processing kernels specialised for one count of enabled combs and
+        allpasses.  Chosen from a table whenever a toggle changes, so the
+        per-sample loops never test an enable flag. */
+    struct Renderers {
+        StereoRenderer block;
+        StereoRenderer samples;
+        WetRenderer wet;
+        MonoWetRenderer monoWet;
+        ChannelRenderer channel;
+        MonoRenderer<float> mono;
+        MonoRenderer<double> mono64;
+    };
+
+    template <int NumCombs, int NumAllPasses>
+    static constexpr Renderers makeRenderers() noexcept;
+    template <std::size_t... Index>
+    static constexpr std::array<Renderers, sizeof...(Index)> makeRendererTable (std::index_sequence<Index...>) noexcept;
+    void updateRenderers() noexcept;
+
+    template <int NumCombs, int NumAllPasses>
+    void renderWetBlock (const float* left, const float* right, int numSamples) noexcept;
+    template <int NumCombs, int NumAllPasses>
+    void renderStereoBlock (const float* left, const float* right, float* out1, float* out2, int numSamples) noexcept;
+    template <int NumCombs, int NumAllPasses>
+    void renderStereoSamples (const float* left, const float* right, float* out1, float* out2, int numSamples) noexcept;
+    template <int NumCombs, int NumAllPasses, typename Sample>
+    void renderMono (Sample* samples, int numSamples) noexcept;
+    template <int NumCombs, int NumAllPasses>
+    void renderMonoWet (const float* in, int numSamples) noexcept;
+    template <int NumCombs, int NumAllPasses>
+    void renderChannel (int channel) noexcept;
+
+    /** Zeroes what reset() left stale in the next numSamples samples of the
+        live lines of the first numChannelsUsed channels, for the renderers
+        that run a sample at a time. */
+    template <int NumCombs, int NumAllPasses>
+    void clearAhead (const int numChannelsUsed, const int numSamples) noexcept {
+        for (int c = 0; c < numChannelsUsed; ++c) {
+            for (int k = 0; k < NumCombs; ++k)
+                combs.clearAhead (2 * k + c, numSamples);
+            for (int k = 0; k < NumAllPasses; ++k)
+                allPass[c][activeAllPasses[k]].clearAhead (numSamples);
+        }
+    }
+
+    void mixBlock (const float* wetL, const float* wetR, const float* left, const float* right,
+                   float* out1, float* out2, int numSamples) noexcept;
+    void runParallel (int numSamples) noexcept;
+    void renderParallel (const float* left, const float* right, float* out1, float* out2, int numSamples) noexcept;
+
+    void runMono (float* const samples, const int numSamples) noexcept { (this->*renderers.mono) (samples, numSamples); }
+    void runMono (double* const samples, const int numSamples) noexcept { (this->*renderers.mono64) (samples, numSamples); }
+
+    template <typename Sample>
+    void mixStereo (const float* wetL, const float* wetR, const Sample* left, const Sample* right,
+                    Sample* out1, Sample* out2, int numSamples) noexcept;
+
+    template <typename Sample>
+    void renderReduced (const Sample* left, const Sample* right, Sample* out1, Sample* out2, int numSamples) noexcept;
+    template <typename Sample>
+    void renderReducedParallel (const Sample* left, const Sample* right, Sample* out1, Sample* out2, int numSamples) noexcept;
+    template <typename Sample>
+    void renderReducedMono (Sample* samples, int numSamples) noexcept;
+    template <typename Sample>
+    void mixMono (const float* wetIn, Sample* samples, int numSamples) noexcept;
+    template <typename Sample>
+    void renderMonoBlock (Sample* samples, int numSamples) noexcept;
+
     //==============================================================================
-    enum { numCombs     = 8,
-           numAllPasses = 4,
-           numChannels  = 2 };
-    bool enabledCombs[numCombs];
-    bool enabledAllPasses[numAllPasses];
+    bool enabledCombs[numCombs] {};
+    bool enabledAllPasses[numAllPasses] {};
+    int activeAllPasses[numAllPasses] {}, numActiveAllPasses = 0;
+    Renderers renderers {};
+    const roboverb::kernels::Kernels* kernels = &roboverb::kernels::select();
+
+    int numLines;
+    double currentSampleRate = 44100.0;
+    bool reduceRate          = false;
+    bool compact             = false;
+    int rateFactor           = 1;
+    bool sleeping    = true;
+    int quietSamples = 0, tailSpan = 0;
 
     Parameters parameters;
     float gain;
 
-    CombFilter comb[numChannels][numCombs];
+    Arena arena;
+    CombBank combs;
     AllPassFilter allPass[numChannels][numAllPasses];
 
     LinearSmoothedValue damping, feedback, dryGain, wetGain1, wetGain2;
+
+    bool blockProcessing = true;
+    alignas (roboverb::simd::alignment) float input[maxBlockSize];
+    alignas (roboverb::simd::alignment) float dampBlock[maxBlockSize];
+    alignas (roboverb::simd::alignment) float feedBlock[maxBlockSize];
+    alignas (roboverb::simd::alignment) float wet[numChannels][maxBlockSize];
+    alignas (roboverb::simd::alignment) float dryBlock[maxBlockSize];
+    alignas (roboverb::simd::alignment) float wetBlock[2][maxBlockSize];
+    alignas (roboverb::simd::alignment) float inputBlock[numChannels][maxBlockSize];
+
+    // the host-rate side of a reduced internal rate
+    roboverb::Decimator decimator;
+    roboverb::Interpolator interpolator;
+    alignas (roboverb::simd::alignment) float hostWet[numChannels][maxBlockSize];
+
+    /** What the two channel tasks of parallel processing share.  Longer
+        than maxBlockSize so a whole host buffer usually takes one round of
+        synchronisation. */
+    struct ParallelBlock {
+        enum { size = 4096 };
+        alignas (roboverb::simd::alignment) float input[size];
+        alignas (roboverb::simd::alignment) float damp[size];
+        alignas (roboverb::simd::alignment) float feedback[size];
+        alignas (roboverb::simd::alignment) float wet[numChannels][size];
+        int numSamples = 0;
+        bool ramped[size / maxBlockSize] {}; /**< per maxBlockSize run */
+    };
+
+    TaskRunner taskRunner = nullptr;
+    void* taskContext     = nullptr;
+    int parallelMinBlockSize = 0;
+    std::unique_ptr<ParallelBlock> parallel;
 };
@@ -0,0 +1,407 @@
+/*
+    This file is part of Roboverb
+
+    Copyright (C) 2025  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// ROBOVERB_SCALAR limits a translation unit to f32x1, for the reference kernels
+#if ROBOVERB_SCALAR
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define ROBOVERB_SSE2 1
+#    include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#    define ROBOVERB_NEON 1
+#    include <arm_neon.h>
+#endif
+
+#if ROBOVERB_SSE2 && defined(__AVX__)
+#    define ROBOVERB_AVX 1
+#endif
+
+#if ROBOVERB_SSE2 && defined(__AVX512F__)
+#    define ROBOVERB_AVX512 1
+#endif
+
+#if ROBOVERB_SSE2 && (defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__)))
+#    define ROBOVERB_FMA 1
+#elif ROBOVERB_NEON && (defined(__aarch64__) || defined(_M_ARM64))
+#    define ROBOVERB_FMA 1
+#    include <cmath>
+#endif
+
+#if ROBOVERB_AVX && (defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__)))
+#    define ROBOVERB_F16C 1
+#elif ROBOVERB_NEON && defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+#    define ROBOVERB_FP16 1
+#endif
+
+namespace roboverb {
+namespace simd {
+
+// Each kernel build gets its own copy of these types, so wider
+// instructions never leak into code shared with the baseline build.
+#ifdef ROBOVERB_KERNEL_ISA
+inline namespace ROBOVERB_KERNEL_ISA {
+#endif
+
+/** Mask value for a lane that is switched on in a select(). */
+inline float laneOn() noexcept {
+    const uint32_t bits = 0xffffffffu;
+    float f;
+    std::memcpy (&f, &bits, sizeof (float));
+    return f;
+}
+
+/** Mask value for a lane that is switched off in a select(). */
+inline float laneOff() noexcept { return 0.0f; }
+
+/** Returns a * b + c, fused where the instruction set has FMA.  Left to
+    itself the compiler contracts some expressions and not others, so the
+    same recursion could round differently depending on which code path
+    ran it. */
+inline float mulAdd (const float a, const float b, const float c) noexcept {
+#if ROBOVERB_FMA && ROBOVERB_SSE2
+    return _mm_cvtss_f32 (_mm_fmadd_ss (_mm_set_ss (a), _mm_set_ss (b), _mm_set_ss (c)));
+#elif ROBOVERB_FMA
+    return std::fma (a, b, c);
+#else
+    return a * b + c;
+#endif
+}
+
+/** Returns an IEEE half float, rounded to nearest even like the hardware
+    conversions. */
+inline uint16_t toHalf (const float f) noexcept {
+#if ROBOVERB_F16C
+    return (uint16_t) _cvtss_sh (f, _MM_FROUND_TO_NEAREST_INT);
+#elif ROBOVERB_FP16
+    const __fp16 h = f;
+    uint16_t bits;
+    std::memcpy (&bits, &h, sizeof (bits));
+    return bits;
+#else
+    uint32_t x;
+    std::memcpy (&x, &f, sizeof (float));
+    const uint32_t sign = (x >> 16) & 0x8000u;
+    x &= 0x7fffffffu;
+
+    if (x >= 0x47800000u) // 65536 and up, infinity or NaN
+        return (uint16_t) (sign | (x > 0x7f800000u ? 0x7e00u : 0x7c00u));
+    if (x < 0x33000000u) // rounds to zero
+        return (uint16_t) sign;
+
+    uint32_t h, rem, half;
+    if (x < 0x38800000u) { // subnormal half
+        const uint32_t shift = 126 - (x >> 23);
+        const uint32_t m     = (x & 0x7fffffu) | 0x800000u;
+        h                    = m >> shift;
+        rem                  = m & ((1u << shift) - 1);
+        half                 = 1u << (shift - 1);
+    } else {
+        h    = (x - 0x38000000u) >> 13;
+        rem  = x & 0x1fffu;
+        half = 0x1000u;
+    }
+
+    // a carry out of the mantissa correctly bumps the exponent
+    if (rem > half || (rem == half && (h & 1)))
+        ++h;
+    return (uint16_t) (sign | h);
+#endif
+}
+
+/** Returns the float an IEEE half float holds exactly. */
+inline float fromHalf (const uint16_t h) noexcept {
+#if ROBOVERB_F16C
+    return _cvtsh_ss (h);
+#elif ROBOVERB_FP16
+    __fp16 f;
+    std::memcpy (&f, &h, sizeof (h));
+    return f;
+#else
+    const uint32_t sign = (uint32_t) (h & 0x8000u) << 16;
+    const uint32_t e    = (h >> 10) & 0x1fu;
+    const uint32_t m    = h & 0x3ffu;
+
+    uint32_t x;
+    if (e == 0) {
+        const float f = (float) m * 5.9604644775390625e-8f; // m * 2^-24
+        return sign != 0 ? -f : f;
+    } else if (e == 31) {
+        x = sign | 0x7f800000u | (m << 13);
+    } else {
+        x = sign | ((e + 112) << 23) | (m << 13);
+    }
+
+    float f;
+    std::memcpy (&f, &x, sizeof (float));
+    return f;
+#endif
+}
+
+/** Converts numSamples half floats to floats, a vector at a time where the
+    instruction set has the conversion. */
+inline void fromHalf (const uint16_t* const source, float* const dest, const int numSamples) noexcept {
+    int i = 0;
+#if ROBOVERB_F16C
+    for (; i + 8 <= numSamples; i += 8)
+        _mm256_storeu_ps (dest + i, _mm256_cvtph_ps (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (source + i))));
+#elif ROBOVERB_FP16
+    for (; i + 4 <= numSamples; i += 4)
+        vst1q_f32 (dest + i, vcvt_f32_f16 (vreinterpret_f16_u16 (vld1_u16 (source + i))));
+#endif
+    for (; i < numSamples; ++i)
+        dest[i] = fromHalf (source[i]);
+}
+
+/** Converts numSamples floats to half floats, a vector at a time where the
+    instruction set has the conversion. */
+inline void toHalf (const float* const source, uint16_t* const dest, const int numSamples) noexcept {
+    int i = 0;
+#if ROBOVERB_F16C
+    for (; i + 8 <= numSamples; i += 8)
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (dest + i),
+                          _mm256_cvtps_ph (_mm256_loadu_ps (source + i), _MM_FROUND_TO_NEAREST_INT));
+#elif ROBOVERB_FP16
+    for (; i + 4 <= numSamples; i += 4)
+        vst1_u16 (dest + i, vreinterpret_u16_f16 (vcvt_f16_f32 (vld1q_f32 (source + i))));
+#endif
+    for (; i < numSamples; ++i)
+        dest[i] = toHalf (source[i]);
+}
+
+/** Single float "vector". Used where no SIMD instruction set is available
+    and as the reference the wider types are checked against. */
+struct f32x1 {
+    static constexpr int width = 1;
+    float v;
+
+    static f32x1 load (const float* p) noexcept { return { *p }; }
+    static f32x1 loadUnaligned (const float* p) noexcept { return { *p }; }
+    static f32x1 broadcast (float x) noexcept { return { x }; }
+    void store (float* p) const noexcept { *p = v; }
+    void storeUnaligned (float* p) const noexcept { *p = v; }
+
+    /** Returns a where mask is on, b elsewhere. */
+    static f32x1 select (f32x1 mask, f32x1 a, f32x1 b) noexcept {
+        uint32_t m, x, y;
+        std::memcpy (&m, &mask.v, sizeof (float));
+        std::memcpy (&x, &a.v, sizeof (float));
+        std::memcpy (&y, &b.v, sizeof (float));
+        x = (x & m) | (y & ~m);
+        f32x1 r;
+        std::memcpy (&r.v, &x, sizeof (float));
+        return r;
+    }
+
+    /** Returns a with every lane moved Lanes lanes up, zeros shifted in. */
+    template <int Lanes>
+    static f32x1 shiftUp (f32x1) noexcept { return { 0.0f }; }
+
+    /** Returns the last lane of a in every lane. */
+    static f32x1 splatLast (f32x1 a) noexcept { return a; }
+
+    /** Returns the last lane of a. */
+    static float lastLane (f32x1 a) noexcept { return a.v; }
+
+    friend f32x1 operator+ (f32x1 a, f32x1 b) noexcept { return { a.v + b.v }; }
+    friend f32x1 operator- (f32x1 a, f32x1 b) noexcept { return { a.v - b.v }; }
+    friend f32x1 operator* (f32x1 a, f32x1 b) noexcept { return { a.v * b.v }; }
+};
+
+inline f32x1 mulAdd (f32x1 a, f32x1 b, f32x1 c) noexcept { return { mulAdd (a.v, b.v, c.v) }; }
+
+#if ROBOVERB_SSE2
+struct f32x4 {
+    static constexpr int width = 4;
+    __m128 v;
+
+    static f32x4 load (const float* p) noexcept { return { _mm_load_ps (p) }; }
+    static f32x4 loadUnaligned (const float* p) noexcept { return { _mm_loadu_ps (p) }; }
+    static f32x4 broadcast (float x) noexcept { return { _mm_set1_ps (x) }; }
+    void store (float* p) const noexcept { _mm_store_ps (p, v); }
+    void storeUnaligned (float* p) const noexcept { _mm_storeu_ps (p, v); }
+
+    static f32x4 select (f32x4 mask, f32x4 a, f32x4 b) noexcept {
+        return { _mm_or_ps (_mm_and_ps (mask.v, a.v), _mm_andnot_ps (mask.v, b.v)) };
+    }
+
+    template <int Lanes>
+    static f32x4 shiftUp (f32x4 a) noexcept {
+        return { _mm_castsi128_ps (_mm_slli_si128 (_mm_castps_si128 (a.v), 4 * Lanes)) };
+    }
+
+    static f32x4 splatLast (f32x4 a) noexcept { return { _mm_shuffle_ps (a.v, a.v, 0xff) }; }
+    static float lastLane (f32x4 a) noexcept { return _mm_cvtss_f32 (splatLast (a).v); }
+
+    friend f32x4 operator+ (f32x4 a, f32x4 b) noexcept { return { _mm_add_ps (a.v, b.v) }; }
+    friend f32x4 operator- (f32x4 a, f32x4 b) noexcept { return { _mm_sub_ps (a.v, b.v) }; }
+    friend f32x4 operator* (f32x4 a, f32x4 b) noexcept { return { _mm_mul_ps (a.v, b.v) }; }
+};
+
+inline f32x4 mulAdd (f32x4 a, f32x4 b, f32x4 c) noexcept {
+#    if ROBOVERB_FMA
+    return { _mm_fmadd_ps (a.v, b.v, c.v) };
+#    else
+    return a * b + c;
+#    endif
+}
+#elif ROBOVERB_NEON
+struct f32x4 {
+    static constexpr int width = 4;
+    float32x4_t v;
+
+    static f32x4 load (const float* p) noexcept { return { vld1q_f32 (p) }; }
+    static f32x4 loadUnaligned (const float* p) noexcept { return { vld1q_f32 (p) }; }
+    static f32x4 broadcast (float x) noexcept { return { vdupq_n_f32 (x) }; }
+    void store (float* p) const noexcept { vst1q_f32 (p, v); }
+    void storeUnaligned (float* p) const noexcept { vst1q_f32 (p, v); }
+
+    static f32x4 select (f32x4 mask, f32x4 a, f32x4 b) noexcept {
+        return { vbslq_f32 (vreinterpretq_u32_f32 (mask.v), a.v, b.v) };
+    }
+
+    template <int Lanes>
+    static f32x4 shiftUp (f32x4 a) noexcept { return { vextq_f32 (vdupq_n_f32 (0.0f), a.v, 4 - Lanes) }; }
+
+    static f32x4 splatLast (f32x4 a) noexcept { return { vdupq_n_f32 (vgetq_lane_f32 (a.v, 3)) }; }
+    static float lastLane (f32x4 a) noexcept { return vgetq_lane_f32 (a.v, 3); }
+
+    friend f32x4 operator+ (f32x4 a, f32x4 b) noexcept { return { vaddq_f32 (a.v, b.v) }; }
+    friend f32x4 operator- (f32x4 a, f32x4 b) noexcept { return { vsubq_f32 (a.v, b.v) }; }
+    friend f32x4 operator* (f32x4 a, f32x4 b) noexcept { return { vmulq_f32 (a.v, b.v) }; }
+};
+
+inline f32x4 mulAdd (f32x4 a, f32x4 b, f32x4 c) noexcept {
+#    if ROBOVERB_FMA
+    return { vfmaq_f32 (c.v, a.v, b.v) };
+#    else
+    return a * b + c;
+#    endif
+}
+#endif
+
+#if ROBOVERB_AVX
+struct f32x8 {
+    static constexpr int width = 8;
+    __m256 v;
+
+    static f32x8 load (const float* p) noexcept { return { _mm256_load_ps (p) }; }
+    static f32x8 loadUnaligned (const float* p) noexcept { return { _mm256_loadu_ps (p) }; }
+    static f32x8 broadcast (float x) noexcept { return { _mm256_set1_ps (x) }; }
+    void store (float* p) const noexcept { _mm256_store_ps (p, v); }
+    void storeUnaligned (float* p) const noexcept { _mm256_storeu_ps (p, v); }
+
+    static f32x8 select (f32x8 mask, f32x8 a, f32x8 b) noexcept {
+        return { _mm256_blendv_ps (b.v, a.v, mask.v) };
+    }
+
+    /** AVX has no lane shift across the two halves, so this builds one
+        from the half swap and in-half shuffles, for 1, 2 or 4 lanes. */
+    template <int Lanes>
+    static f32x8 shiftUp (f32x8 a) noexcept {
+        static_assert (Lanes == 1 || Lanes == 2 || Lanes == 4, "f32x8 shifts by 1, 2 or 4 lanes");
+        const __m256 low = _mm256_permute2f128_ps (a.v, a.v, 0x08); // zeros, then the low half
+        if (Lanes == 4)
+            return { low };
+        if (Lanes == 2)
+            return { _mm256_shuffle_ps (low, a.v, _MM_SHUFFLE (1, 0, 3, 2)) };
+        const __m256 pairs = _mm256_shuffle_ps (low, a.v, _MM_SHUFFLE (0, 0, 3, 3));
+        return { _mm256_shuffle_ps (pairs, a.v, _MM_SHUFFLE (2, 1, 2, 0)) };
+    }
+
+    static f32x8 splatLast (f32x8 a) noexcept {
+        const __m256 last = _mm256_permute_ps (a.v, 0xff);
+        return { _mm256_permute2f128_ps (last, last, 0x11) };
+    }
+
+    static float lastLane (f32x8 a) noexcept { return _mm256_cvtss_f32 (splatLast (a).v); }
+
+    friend f32x8 operator+ (f32x8 a, f32x8 b) noexcept { return { _mm256_add_ps (a.v, b.v) }; }
+    friend f32x8 operator- (f32x8 a, f32x8 b) noexcept { return { _mm256_sub_ps (a.v, b.v) }; }
+    friend f32x8 operator* (f32x8 a, f32x8 b) noexcept { return { _mm256_mul_ps (a.v, b.v) }; }
+};
+
+inline f32x8 mulAdd (f32x8 a, f32x8 b, f32x8 c) noexcept {
+#    if ROBOVERB_FMA
+    return { _mm256_fmadd_ps (a.v, b.v, c.v) };
+#    else
+    return a * b + c;
+#    endif
+}
+#endif
+
+#if ROBOVERB_AVX512
+struct f32x16 {
+    static constexpr int width = 16;
+    __m512 v;
+
+    static f32x16 load (const float* p) noexcept { return { _mm512_load_ps (p) }; }
+    static f32x16 loadUnaligned (const float* p) noexcept { return { _mm512_loadu_ps (p) }; }
+    static f32x16 broadcast (float x) noexcept { return { _mm512_set1_ps (x) }; }
+    void store (float* p) const noexcept { _mm512_store_ps (p, v); }
+    void storeUnaligned (float* p) const noexcept { _mm512_storeu_ps (p, v); }
+
+    static f32x16 select (f32x16 mask, f32x16 a, f32x16 b) noexcept {
+        const __mmask16 m = _mm512_test_epi32_mask (_mm512_castps_si512 (mask.v), _mm512_castps_si512 (mask.v));
+        return { _mm512_mask_blend_ps (m, b.v, a.v) };
+    }
+
+    template <int Lanes>
+    static f32x16 shiftUp (f32x16 a) noexcept {
+        const __m512i shifted = _mm512_maskz_alignr_epi32 ((__mmask16) 0xffff, _mm512_castps_si512 (a.v),
+                                                           _mm512_setzero_si512(), 16 - Lanes);
+        return { _mm512_castsi512_ps (shifted) };
+    }
+
+    static f32x16 splatLast (f32x16 a) noexcept {
+        return { _mm512_maskz_permutexvar_ps ((__mmask16) 0xffff, _mm512_set1_epi32 (15), a.v) };
+    }
+    static float lastLane (f32x16 a) noexcept { return _mm512_cvtss_f32 (splatLast (a).v); }
+
+    friend f32x16 operator+ (f32x16 a, f32x16 b) noexcept { return { _mm512_add_ps (a.v, b.v) }; }
+    friend f32x16 operator- (f32x16 a, f32x16 b) noexcept { return { _mm512_sub_ps (a.v, b.v) }; }
+    friend f32x16 operator* (f32x16 a, f32x16 b) noexcept { return { _mm512_mul_ps (a.v, b.v) }; }
+};
+
+inline f32x16 mulAdd (f32x16 a, f32x16 b, f32x16 c) noexcept { return { _mm512_fmadd_ps (a.v, b.v, c.v) }; }
+#endif
+
+/** The widest vector type this translation unit was compiled for. */
+#if ROBOVERB_AVX512
+using native = f32x16;
+#elif ROBOVERB_AVX
+using native = f32x8;
+#elif ROBOVERB_SSE2 || ROBOVERB_NEON
+using native = f32x4;
+#else
+using native = f32x1;
+#endif
+
+#ifdef ROBOVERB_KERNEL_ISA
+} // namespace ROBOVERB_KERNEL_ISA
+#endif
+
+/** Alignment, in bytes, that load() and store() expect. */
+static constexpr int alignment = 64;
+
+} // namespace simd
+} // namespace roboverb